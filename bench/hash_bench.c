@@ -0,0 +1,109 @@
+/**
+ * @file hash_bench.c
+ * @brief Benchmark of reduce_by_key, preduce_by_key and the hash joins.
+ * with one pthread_create and pthread_join per chunk.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lambda_hash.h"
+#include "lambda_sort.h"
+
+typedef struct {
+    unsigned key;
+    float amount;
+} record_t;
+
+typedef hash_table_t(unsigned, double) sum_table;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, long keys, long n, double seconds, double check) {
+    printf("%-16s %8ld keys %8.2f ns/element (check %g)\n", name, keys, seconds * 1e9 / n, check);
+}
+
+int main(int argc, char **argv) {
+    // Number of records, 10^7 unless given on the command line
+    long n = argc > 1 ? atol(argv[1]) : 10000000;
+    int nthreads = lc_pool_size() + 1;
+    record_t *records = malloc(n * sizeof(record_t));
+    record_t *sorted = malloc(n * sizeof(record_t));
+    for (long keys = 16; keys <= 1000000; keys *= 250) {
+        srand(1);
+        for (long i = 0; i < n; i++) records[i] = (record_t){ rand() % keys, 1.0f };
+
+        sum_table sums = LC_HASH_INIT;
+        double t = now();
+        reduce_by_key(unsigned, double, record_t, records, n, { return value.key; },
+                      { return acc + value.amount; }, 0.0, &sums);
+        report("reduce_by_key", hash_size(&sums), n, now() - t, *hash_find(&sums, 0u));
+        hash_free(&sums);
+
+        t = now();
+        preduce_by_key(unsigned, double, record_t, records, n, { return value.key; },
+                       { return acc + value.amount; }, { return acc + value; }, 0.0,
+                       &sums, nthreads);
+        report("preduce_by_key", hash_size(&sums), n, now() - t, *hash_find(&sums, 0u));
+        hash_free(&sums);
+
+        // Sort by key, then sum the runs of equal keys
+        t = now();
+        memcpy(sorted, records, n * sizeof(record_t));
+        sort_by_key(record_t, unsigned, sorted, n, { return value.key; });
+        long runs = 0;
+        double first = 0;
+        for (long i = 0, j; i < n; i = j) {
+            double sum = 0;
+            for (j = i; j < n && sorted[j].key == sorted[i].key; j++) sum += sorted[j].amount;
+            if (runs++ == 0) first = sum;
+        }
+        report("sort_by_key+scan", runs, n, now() - t, first);
+    }
+
+    // Join the records with a table of n / 10 then n / 2 distinct keys
+    for (long m = n / 10; m <= n / 2; m *= 5) {
+        record_t *table = sorted;
+        for (long i = 0; i < m; i++) table[i] = (record_t){ i, 2.0f };
+        for (long i = 0; i < n; i++) records[i].key = rand() % (2 * m);
+        double sum = 0, t = now();
+        size_t pairs = hash_join(unsigned, record_t, record_t, records, n, table, m,
+                                 { return value.key; }, { return value.key; },
+                                 { sum += left.amount * right.amount; });
+        report("hash_join", m, n, now() - t, sum + pairs);
+        sum = 0;
+        t = now();
+        pairs = hash_join_radix(unsigned, record_t, record_t, records, n, table, m,
+                                { return value.key; }, { return value.key; },
+                                { sum += left.amount * right.amount; });
+        report("hash_join_radix", m, n, now() - t, sum + pairs);
+    }
+    free(records);
+    free(sorted);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file inline_bench.c
+ * @brief Compare fold/map with their inline variants, zip_map/zip_fold and plain loops.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lambda.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, double seconds, int n, double check) {
+    printf("%-12s %8.3f ns/element  (check %g)\n", name, seconds * 1e9 / n, check);
+}
+
+int main(int argc, char **argv) {
+    // Number of doubles, 10^8 unless given on the command line
+    int n = argc > 1 ? atoi(argv[1]) : 100000000;
+    double *in = malloc(n * sizeof(double));
+    double *out = malloc(n * sizeof(double));
+    if (!in || !out) {
+        fprintf(stderr, "cannot allocate %d doubles\n", n);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) in[i] = i % 1000 * 0.001;
+
+    double scale = 2.0;
+    double t, r;
+
+    t = now();
+    r = fold(double, double, in, n, { return acc + value * scale; }, 0.0);
+    report("fold", now() - t, n, r);
+
+    t = now();
+    r = fold_inline(double, double, in, n, { acc + value * scale; }, 0.0);
+    report("fold_inline", now() - t, n, r);
+
+    t = now();
+    r = 0.0;
+    for (int i = 0; i < n; i++) r += in[i] * scale;
+    report("fold loop", now() - t, n, r);
+
+    t = now();
+    map(double, in, n, { return value * scale + 1.0; }, out);
+    report("map", now() - t, n, out[n - 1]);
+
+    t = now();
+    map_inline(double, in, n, { value * scale + 1.0; }, out);
+    report("map_inline", now() - t, n, out[n - 1]);
+
+    t = now();
+    for (int i = 0; i < n; i++) out[i] = in[i] * scale + 1.0;
+    report("map loop", now() - t, n, out[n - 1]);
+
+    // Two input streams: out = scale * in + out
+    t = now();
+    map(double, in, n, { return value * scale + out[index]; }, out);
+    report("map 2 arrays", now() - t, n, out[n - 1]);
+
+    t = now();
+    zip_map(double, (double, double), (in, out), n, { return a * scale + b; }, out);
+    report("zip_map", now() - t, n, out[n - 1]);
+
+    t = now();
+    for (int i = 0; i < n; i++) out[i] = in[i] * scale + out[i];
+    report("zip loop", now() - t, n, out[n - 1]);
+
+    t = now();
+    r = zip_fold(double, (double, double), (in, out), n, { return acc + a * b; }, 0.0);
+    report("zip_fold", now() - t, n, r);
+
+    free(in);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file lambda_bench.c
+ * @brief Time every lambda.h construct against the equivalent plain C loop.
+ *
+ * For int, double and struct elements, and sizes from 10^3 up to
+ * 10^max_exp elements, each construct and its hand-written loop are
+ * timed; ns/element and GB/s are printed and appended to a CSV file.
+ *
+ * Usage: lambda_bench [max_exp [csv_file]]
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "lambda_arena.h"
+
+// Total number of elements processed per measurement, spread over repetitions
+#define WORK 10000000
+
+typedef struct {
+    double x, y;
+    int id;
+} record;
+
+static inline double get_int(int v) { return v; }
+static inline int scale_int(int v) { return v * 3; }
+static inline int make_int(size_t i) { return i % 1000; }
+
+static inline double get_double(double v) { return v; }
+static inline double scale_double(double v) { return v * 3.0; }
+static inline double make_double(size_t i) { return i % 1000 * 0.5; }
+
+static inline double get_record(record v) { return v.x; }
+static inline record scale_record(record v) { v.x *= 3.0; return v; }
+static inline record make_record(size_t i) { return (record){ i % 1000 * 0.5, 1.0, (int)i }; }
+
+// Calling convention of the bodies, recorded with every result
+#ifdef LAMBDA_NO_TRAMPOLINE
+#define MODE "direct"
+#else
+#define MODE "trampoline"
+#endif
+
+static FILE *csv;
+static volatile double sink;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *construct, const char *variant, const char *type,
+                   size_t n, int reps, double seconds, size_t bytes_per_element) {
+    double per_element = seconds / ((double)n * reps);
+    double ns = per_element * 1e9;
+    double gbs = bytes_per_element / per_element * 1e-9;
+    printf("%-10s %-6s %-7s %11zu %10.3f ns/elt %8.3f GB/s\n",
+           construct, variant, type, n, ns, gbs);
+    if (csv) fprintf(csv, "%s,%s,%s,%s,%zu,%.6f,%.6f\n",
+                     construct, variant, MODE, type, n, ns, gbs);
+}
+
+// Time the statements repeated `reps` times, then report it
+#define MEASURE(construct, variant, T, n, reps, bytes, ...) ({ \
+    double _t = now();                                          \
+    for (int _r = 0; _r < reps; _r++) { __VA_ARGS__; }          \
+    report(construct, variant, #T, n, reps, now() - _t, bytes); })
+
+#define BENCH_TYPE(T)                                                        \
+typedef struct node_##T {                                                    \
+    T v;                                                                     \
+    struct node_##T *next;                                                   \
+} node_##T;                                                                  \
+                                                                             \
+static void bench_array_##T(size_t n, int reps) {                            \
+    T *in = malloc(n * sizeof(T)), *out = malloc(n * sizeof(T));             \
+    if (!in || !out) {                                                       \
+        printf("skipping arrays of %zu " #T ": out of memory\n", n);         \
+        free(in); free(out);                                                 \
+        return;                                                              \
+    }                                                                        \
+    for (size_t i = 0; i < n; i++) in[i] = make_##T(i);                      \
+    double r = 0;                                                            \
+    MEASURE("fold", "macro", T, n, reps, sizeof(T),                          \
+        r += fold(double, T, in, n, { return acc + get_##T(value); }, 0.0)); \
+    MEASURE("fold", "loop", T, n, reps, sizeof(T),                           \
+        double acc = 0.0;                                                    \
+        for (size_t i = 0; i < n; i++) acc += get_##T(in[i]);                \
+        r += acc);                                                           \
+    MEASURE("map", "macro", T, n, reps, 2 * sizeof(T),                       \
+        map(T, in, n, { return scale_##T(value); }, out));                   \
+    r += get_##T(out[n - 1]);                                                \
+    MEASURE("map", "loop", T, n, reps, 2 * sizeof(T),                        \
+        for (size_t i = 0; i < n; i++) out[i] = scale_##T(in[i]));           \
+    r += get_##T(out[n - 1]);                                                \
+    sink = r;                                                                \
+    free(in);                                                                \
+    free(out);                                                               \
+}                                                                            \
+                                                                             \
+static void bench_list_##T(size_t n, int reps) {                             \
+    node_##T *nodes = malloc(n * sizeof(node_##T));                          \
+    if (!nodes) {                                                            \
+        printf("skipping lists of %zu " #T ": out of memory\n", n);          \
+        return;                                                              \
+    }                                                                        \
+    for (size_t i = 0; i < n; i++) {                                         \
+        nodes[i].v = make_##T(i);                                            \
+        nodes[i].next = i + 1 < n ? &nodes[i + 1] : NULL;                    \
+    }                                                                        \
+    node_##T *head = nodes;                                                  \
+    lc_arena mapped = LC_ARENA_INIT;                                         \
+    double r = 0;                                                            \
+    MEASURE("fold_s", "macro", T, n, reps, sizeof(node_##T),                 \
+        r += fold_s(double, node_##T *, head, { return value->next; },       \
+                    { return acc + get_##T(value->v); }, 0.0));              \
+    MEASURE("fold_s", "loop", T, n, reps, sizeof(node_##T),                  \
+        double acc = 0.0;                                                    \
+        for (node_##T *p = head; p; p = p->next) acc += get_##T(p->v);       \
+        r += acc);                                                           \
+    MEASURE("foreach_s", "macro", T, n, reps, sizeof(node_##T),              \
+        double acc = 0.0;                                                    \
+        foreach_s(node_##T *, head,                                          \
+                  { acc += get_##T(value->v); return value->next; });        \
+        r += acc);                                                           \
+    MEASURE("foreach_s", "loop", T, n, reps, sizeof(node_##T),               \
+        double acc = 0.0;                                                    \
+        for (node_##T *p = head; p; p = p->next) acc += get_##T(p->v);       \
+        r += acc);                                                           \
+    MEASURE("map_s", "macro", T, n, reps, 2 * sizeof(node_##T),              \
+        node_##T *m = map_s_arena(node_##T *, head, { return value->next; }, \
+          {                                                                  \
+            node_##T *q = lc_arena_new(arena, node_##T);                     \
+            q->v = scale_##T(value->v);                                      \
+            q->next = next;                                                  \
+            return q;                                                        \
+          }, &mapped);                                                       \
+        r += get_##T(m->v);                                                  \
+        lc_arena_release(&mapped));                                          \
+    MEASURE("map_s", "loop", T, n, reps, 2 * sizeof(node_##T),               \
+        node_##T *m = NULL, **tail = &m;                                     \
+        for (node_##T *p = head; p; p = p->next) {                           \
+            node_##T *q = lc_arena_new(&mapped, node_##T);                   \
+            q->v = scale_##T(p->v);                                          \
+            *tail = q;                                                       \
+            tail = &q->next;                                                 \
+        }                                                                    \
+        *tail = NULL;                                                        \
+        r += get_##T(m->v);                                                  \
+        lc_arena_release(&mapped));                                          \
+    sink = r;                                                                \
+    free(nodes);                                                             \
+}
+
+BENCH_TYPE(int)
+BENCH_TYPE(double)
+BENCH_TYPE(record)
+
+int main(int argc, char **argv) {
+    int max_exp = argc > 1 ? atoi(argv[1]) : 9;
+    const char *csv_path = argc > 2 ? argv[2] : "bench.csv";
+    csv = fopen(csv_path, "a");
+    if (!csv) {
+        perror(csv_path);
+        return 1;
+    }
+    // Header row only for a new (empty) file, each run appending its rows
+    fseek(csv, 0, SEEK_END);
+    if (ftell(csv) == 0)
+        fprintf(csv, "construct,variant,mode,type,size,ns_per_element,gb_per_s\n");
+
+    // Sizes whose working set exceeds half of the physical memory are skipped
+    size_t memory = (size_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+
+    size_t n = 1000;
+    for (int e = 3; e <= max_exp; e++, n *= 10) {
+        int reps = n < WORK ? WORK / n : 1;
+#define RUN(T)                                                                  \
+        if (2 * n * sizeof(T) <= memory) bench_array_##T(n, reps);              \
+        else printf("skipping arrays of %zu " #T ": above half the memory\n", n);\
+        if (2 * n * sizeof(node_##T) <= memory) bench_list_##T(n, reps);        \
+        else printf("skipping lists of %zu " #T ": above half the memory\n", n);
+        RUN(int)
+        RUN(double)
+        RUN(record)
+#undef RUN
+    }
+
+    fclose(csv);
+    printf("results appended to %s\n", csv_path);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file pool_bench.c
+ * @brief Compare the dispatch cost of the thread pool of lambda_pool.h
+ * with one pthread_create and pthread_join per chunk.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lambda_parallel.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, int chunks, double seconds, int calls) {
+    printf("%-14s %2d chunks %10.3f us/dispatch\n", name, chunks, seconds * 1e6 / calls);
+}
+
+static long counts[64];
+
+static void count(int t) { counts[t * 8]++; }
+
+static void *spawned(void *arg) {
+    count((int)(long)arg);
+    return NULL;
+}
+
+// Former _lc_parallel_run: a thread per chunk but the first
+static void spawn_run(int n, void (*chunk)(int)) {
+    pthread_t threads[n];
+    for (int t = 1; t < n; t++) pthread_create(&threads[t], NULL, spawned, (void *)(long)t);
+    chunk(0);
+    for (int t = 1; t < n; t++) pthread_join(threads[t], NULL);
+}
+
+int main(int argc, char **argv) {
+    // Number of dispatches, 10^4 unless given on the command line
+    int calls = argc > 1 ? atoi(argv[1]) : 10000;
+    printf("%d pool workers\n", lc_pool_size());
+    for (int chunks = 2; chunks <= 8; chunks *= 2) {
+        double t = now();
+        for (int c = 0; c < calls; c++) spawn_run(chunks, count);
+        report("spawn/join", chunks, now() - t, calls);
+        t = now();
+        for (int c = 0; c < calls; c++) lc_pool_run(chunks, count);
+        report("lc_pool_run", chunks, now() - t, calls);
+    }
+    // A small parallel fold, dominated by its dispatch
+    int n = 1024;
+    double *a = malloc(n * sizeof(double));
+    for (int i = 0; i < n; i++) a[i] = i;
+    double check = 0, t = now();
+    for (int c = 0; c < calls; c++)
+        check += pfold(double, double, a, n, { return acc + value; },
+                       { return acc + value; }, 0.0, 4);
+    report("pfold 1024", 4, now() - t, calls);
+    printf("(check %g)\n", check);
+    free(a);
+    return 0;
+}
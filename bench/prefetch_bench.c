@@ -0,0 +1,158 @@
+/**
+ * @file prefetch_bench.c
+ * @brief Time fold_s, foreach_s and map_s against their prefetching,
+ * batched and parallel variants on a linked list laid out randomly in memory.
+ *
+ * Every node sits on a cache line of its own and the nodes are linked
+ * in a random order, so each step of the traversal is a cache miss.
+ *
+ * Usage: prefetch_bench [nodes [work]]
+ *   work: rounds of arithmetic done by the body on each node (default 32).
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lambda_parallel.h"
+
+typedef struct node {
+    long data;
+    struct node *next;
+    char pad[48];
+} node;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, int distance, double seconds, long n, long check) {
+    printf("%-20s d=%-3d %8.3f ns/node  (check %ld)\n", name, distance, seconds * 1e9 / n, check);
+}
+
+// Some work on a node, independent of the traversal
+static inline long work(long x, int rounds) {
+    for (int r = 0; r < rounds; r++) x = x * 6364136223846793005L + 1442695040888963407L;
+    return x >> 33;
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 4000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 32;
+    node *nodes = malloc(n * sizeof(node));
+    long *order = malloc(n * sizeof(long));
+    if (!nodes || !order) {
+        fprintf(stderr, "cannot allocate %ld nodes\n", n);
+        return 1;
+    }
+
+    // Link the nodes in a random order
+    for (long i = 0; i < n; i++) order[i] = i;
+    srand(42);
+    for (long i = n - 1; i > 0; i--) {
+        long j = ((long)rand() * RAND_MAX + rand()) % (i + 1);
+        long t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for (long i = 0; i < n; i++) {
+        nodes[order[i]].data = i;
+        nodes[order[i]].next = i + 1 < n ? &nodes[order[i + 1]] : NULL;
+    }
+    node *head = &nodes[order[0]];
+    free(order);
+
+    double t;
+    long r;
+
+    t = now();
+    r = fold_s(long, node *, head, { return value->next; },
+               { return acc + work(value->data, rounds); }, 0);
+    report("fold_s", 0, now() - t, n, r);
+    for (int d = 4; d <= 32; d *= 2) {
+        t = now();
+        r = fold_s_prefetch(long, node *, head, { return value->next; },
+                            { return acc + work(value->data, rounds); }, 0, d);
+        report("fold_s_prefetch", d, now() - t, n, r);
+    }
+
+    for (int b = 8; b <= 64; b *= 2) {
+        t = now();
+        r = fold_s_batch(long, node *, head, { return value->next; },
+                         { return acc + work(value->data, rounds); }, 0, b);
+        report("fold_s_batch", b, now() - t, n, r);
+    }
+
+    // Gather the node pointers once, then fold the array of pointers
+    typedef vec_t(node *) node_vec;
+    node_vec gathered = LC_VEC_INIT;
+    t = now();
+    collect_s(node *, head, { return value->next; }, &gathered);
+    report("collect_s", 0, now() - t, n, gathered.size);
+    t = now();
+    r = fold(long, node *, gathered.data, gathered.size,
+             { return acc + work(value->data, rounds); }, 0);
+    report("fold on collected", 0, now() - t, n, r);
+    vec_free(&gathered);
+
+    // Split points recorded once, then the segments folded on the pool
+    node_vec splits = LC_VEC_INIT;
+    t = now();
+    split_s(node *, head, { return value->next; }, 1024, &splits);
+    report("split_s", 1024, now() - t, n, splits.size);
+    t = now();
+    r = pfold_s_splits(long, node *, splits.data, splits.size, { return value->next; },
+                       { return acc + work(value->data, rounds); },
+                       { return acc + value; }, 0, lc_pool_size() + 1);
+    report("pfold_s_splits", 1024, now() - t, n, r);
+    vec_free(&splits);
+
+    t = now();
+    r = 0;
+    foreach_s(node *, head, { r += work(value->data, rounds); return value->next; });
+    report("foreach_s", 0, now() - t, n, r);
+    for (int d = 4; d <= 32; d *= 2) {
+        t = now();
+        r = 0;
+        foreach_s_prefetch(node *, head, { return value->next; },
+                           { r += work(value->data, rounds); }, d);
+        report("foreach_s_prefetch", d, now() - t, n, r);
+    }
+
+    // map_s over the list, building a list of the same length in place
+    for (int d = 0; d <= 16; d += 8) {
+        long *results = malloc(n * sizeof(long)), *out = results;
+        t = now();
+        if (d == 0)
+            map_s(node *, head, { return value->next; },
+                  { *out++ = work(value->data, rounds); return next; });
+        else
+            map_s_prefetch(node *, head, { return value->next; },
+                           { *out++ = work(value->data, rounds); return next; }, d);
+        report(d ? "map_s_prefetch" : "map_s", d, now() - t, n, results[n - 1]);
+        free(results);
+    }
+
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file simd_bench.c
+ * @brief Compare fold_sum/min/max/dot, the operator tags of fold and
+ * filter_simd with the equivalent generic construct and plain loop.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lambda_simd.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, const char *type, double seconds, int n, double check) {
+    printf("%-11s %-7s %8.3f ns/element  (check %g)\n", name, type, seconds * 1e9 / n, check);
+}
+
+// Time an expression evaluated once over the n elements, then report it
+#define MEASURE(name, T, n, ...) ({     \
+    double _t = now();                  \
+    double _r = (__VA_ARGS__);          \
+    report(name, #T, now() - _t, n, _r); })
+
+#define BENCH_TYPE(T)                                                         \
+static void bench_##T(int n) {                                                \
+    T *a = malloc(n * sizeof(T)), *b = malloc(n * sizeof(T));                 \
+    if (!a || !b) {                                                           \
+        fprintf(stderr, "cannot allocate %d " #T "\n", n);                    \
+        free(a); free(b);                                                     \
+        return;                                                               \
+    }                                                                         \
+    for (int i = 0; i < n; i++) {                                             \
+        a[i] = (T)(i % 1000);                                                 \
+        b[i] = (T)(i % 7);                                                    \
+    }                                                                         \
+    MEASURE("fold sum", T, n, fold(T, T, a, n, { return acc + value; }, 0));  \
+    MEASURE("fold_sum", T, n, fold_sum(a, n));                                \
+    MEASURE("LC_ADD", T, n, fold(T, T, a, n, LC_ADD, (T)0));                  \
+    MEASURE("fold max", T, n,                                                 \
+        fold(T, T, a, n, { return value > acc ? value : acc; }, a[0]));       \
+    MEASURE("fold_max", T, n, fold_max(a, n));                                \
+    MEASURE("LC_MAX", T, n, fold(T, T, a, n, LC_MAX, a[0]));                  \
+    MEASURE("fold_min", T, n, fold_min(a, n));                                \
+    MEASURE("dot loop", T, n, ({                                              \
+        T acc = 0;                                                            \
+        for (int i = 0; i < n; i++) acc += a[i] * b[i];                       \
+        acc; }));                                                             \
+    MEASURE("fold_dot", T, n, fold_dot(a, b, n));                             \
+    /* Half of the elements kept, in random order */                          \
+    for (int i = 0; i < n; i++) b[i] = (T)(rand() % 1000);                    \
+    MEASURE("if loop", T, n, ({                                               \
+        int kept = 0;                                                         \
+        for (int i = 0; i < n; i++) if (b[i] < 500) a[kept++] = b[i];         \
+        kept; }));                                                            \
+    MEASURE("filter", T, n, filter(T, b, n, { return value < 500; }, a));     \
+    MEASURE("filter_simd", T, n, filter_simd(T, b, n, { value < 500; }, a));  \
+    free(a);                                                                  \
+    free(b);                                                                  \
+}
+
+BENCH_TYPE(double)
+BENCH_TYPE(float)
+BENCH_TYPE(int)
+
+int main(int argc, char **argv) {
+    // Number of elements, 10^7 unless given on the command line
+    int n = argc > 1 ? atoi(argv[1]) : 10000000;
+    bench_double(n);
+    bench_float(n);
+    bench_int(n);
+    return 0;
+}
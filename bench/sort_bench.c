@@ -0,0 +1,113 @@
+/**
+ * @file sort_bench.c
+ * @brief Compare sort, sort_by_key and psort with qsort on records
+ * with a 64-bit key.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "lambda_sort.h"
+
+typedef struct {
+    uint64_t key;
+    uint64_t payload;
+} record;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Same pseudo-random records before each sort
+static void fill(record *r, size_t n) {
+    uint64_t x = 88172645463325252ULL;
+    for (size_t i = 0; i < n; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        r[i].key = x;
+        r[i].payload = i;
+    }
+}
+
+static void report(const char *name, double seconds, record *r, size_t n) {
+    size_t unsorted = 0;
+    for (size_t i = 1; i < n; i++) unsorted += r[i - 1].key > r[i].key;
+    printf("%-14s %8.3f s %8.2f ns/record%s\n", name, seconds, seconds * 1e9 / n,
+           unsorted ? "  (NOT SORTED)" : "");
+}
+
+static int compare(const void *a, const void *b) {
+    uint64_t x = ((const record *)a)->key, y = ((const record *)b)->key;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    // Number of records, 10^8 unless given on the command line; halved
+    // while the records and a sort buffer exceed half the physical memory
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000000;
+    size_t memory = (size_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+    while (n > 1 && 2 * n * sizeof(record) > memory) n /= 2;
+    record *r = malloc(n * sizeof(record));
+    if (!r) {
+        fprintf(stderr, "cannot allocate %zu records\n", n);
+        return 1;
+    }
+    int nthreads = lc_pool_size() + 1;
+    printf("%zu records of %zu bytes, %d threads for psort\n", n, sizeof(record), nthreads);
+    double t;
+
+    fill(r, n);
+    t = now();
+    qsort(r, n, sizeof(record), compare);
+    report("qsort", now() - t, r, n);
+
+    fill(r, n);
+    t = now();
+    qsort(r, n, sizeof(record), 𝛌(int, (const void *a, const void *b), {
+        uint64_t x = ((const record *)a)->key;
+        uint64_t y = ((const record *)b)->key;
+        return (x > y) - (x < y);
+    }));
+    report("qsort lambda", now() - t, r, n);
+
+    fill(r, n);
+    t = now();
+    sort(record, r, n, { return a.key < b.key; });
+    report("sort", now() - t, r, n);
+
+    fill(r, n);
+    t = now();
+    sort_by_key(record, uint64_t, r, n, { return value.key; });
+    report("sort_by_key", now() - t, r, n);
+
+    fill(r, n);
+    t = now();
+    psort(record, r, n, { return a.key < b.key; }, nthreads);
+    report("psort", now() - t, r, n);
+
+    free(r);
+    return 0;
+}
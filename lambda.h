@@ -29,6 +29,18 @@
 #ifndef _lambda_h
 #define _lambda_h
 
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * @brief Type of the array indices, `size_t` unless LAMBDA_INDEX_TYPE 
+ * is defined before this file is included.
+ */
+#ifndef LAMBDA_INDEX_TYPE
+#define LAMBDA_INDEX_TYPE size_t
+#endif
+typedef LAMBDA_INDEX_TYPE lc_index_t;
+
 /**
  * @brief Define a lambda function using the GNU99 C standard.
  * 
@@ -49,13 +61,205 @@
  * Usage:
  * @code
  *   // Call a sort function with a comparaison operator :
- *   sort(t,size,𝛌(int, (int a, int b), { return a > b; }));
+ *   qsort(t, size, sizeof(int), 𝛌(int, (const void *a, const void *b),
+ *         { return *(const int *)b - *(const int *)a; }));
+ *   
+ *   // sort of lambda_sort.h takes the body itself, and inlines it :
+ *   sort(int, t, size, { return a > b; });
  *   
  * @endcode
  */
 #define 𝛌(ret, args, body) ({ret _𝛌 args body; _𝛌;})
 #define lambda 𝛌
 
+/**
+ * @brief Bind a lambda body to a local name inside a construct.
+ *
+ * fold, map, scan, filter and the fold_s family go through this helper
+ * rather than calling 𝛌 in place, so the body is defined once, before
+ * the loop.
+ *
+ * Some constructs bypass it and declare nested functions that they only
+ * call by name, in both modes: _fold_s_range (behind pfold_s),
+ * fold_s_batch, zip_map, zip_fold, and the early exit scans (index_of,
+ * find, any, all, fold_until and their _s variants). So do sort and psort
+ * (lambda_sort.h), and reduce_by_key and the hash joins (lambda_hash.h).
+ * Their loops are hot enough that the body must be inlined, so that
+ * zip loops vectorize. A trampoline would also share a cache line with
+ * variables written on every iteration, and each such write would
+ * flush the pipeline as self-modifying code.
+ *
+ * By default the name is a function pointer obtained from 𝛌: the body
+ * is reached through a trampoline written on the stack.
+ * When LAMBDA_NO_TRAMPOLINE is defined, the name is a nested function
+ * that is only ever called directly. GCC then passes the enclosing frame
+ * in the static chain register, no trampoline is generated and the
+ * program links with a non-executable stack.
+ *
+ * @param name  Local name given to the lambda.
+ * @param ret   Return type of the lambda function.
+ * @param args  Argument list enclosed in parentheses.
+ * @param body  Body of the lambda function enclosed in braces.
+ */
+#ifdef LAMBDA_NO_TRAMPOLINE
+#define _𝛌_bind(name, ret, args, body) ret name args body
+#else
+#define _𝛌_bind(name, ret, args, body) ret (*name) args = 𝛌(ret, args, body)
+#endif
+
+#define _LC_STRIP(...) __VA_ARGS__
+#define _LC_CAT(a, b) _LC_CAT_(a, b)
+#define _LC_CAT_(a, b) a##b
+/* 1 when x starts with a parenthesis (an operator tag), 0 otherwise (a body). */
+#define _LC_IS_PAREN(x) _LC_SECOND(_LC_IS_PAREN_PROBE x, 0, )
+#define _LC_IS_PAREN_PROBE(...) ~, 1
+#define _LC_SECOND(...) _LC_SECOND_(__VA_ARGS__)
+#define _LC_SECOND_(a, b, ...) b
+/* Number of arguments, from 1 to 4. */
+#define _LC_NARGS(...) _LC_NARGS_(__VA_ARGS__, 4, 3, 2, 1, )
+#define _LC_NARGS_(a, b, c, d, n, ...) n
+
+/**
+ * @brief Declare a fat closure type: an explicit environment paired 
+ * with a plain function pointer.
+ *
+ * A lambda whose address escapes (stored, returned to a caller, given
+ * to a callback API) needs a trampoline, because its code pointer alone
+ * cannot carry the enclosing frame. A fat closure carries that frame
+ * explicitly: the function receives a pointer to an environment structure
+ * as first argument and captures nothing else.
+ *
+ * @param ret       Return type of the closure.
+ * @param env_type  Type of the environment structure.
+ * @param ...       Argument types of the closure, environment excluded.
+ *
+ * Usage:
+ * @code
+ *   typedef struct { int threshold; } cmp_env;
+ *   typedef closure_t(int, cmp_env, int, int) cmp_closure;
+ * @endcode
+ */
+#define closure_t(ret, env_type, ...) \
+  struct { ret (*fn)(env_type * __VA_OPT__(,) __VA_ARGS__); env_type *env; }
+
+/**
+ * @brief Build a fat closure from a function and an environment.
+ *
+ * The function is defined at file scope and takes the pointer to the
+ * environment as first argument: it captures nothing, so storing its
+ * address needs no trampoline, whatever the optimization level.
+ *
+ * @param type     Closure type, declared with closure_t.
+ * @param fn       Function taking `env_type *` then the arguments of the
+ *                 closure.
+ * @param env_ptr  Pointer to the environment.
+ *
+ * Usage:
+ * @code
+ *   static int above_fn(cmp_env *env, int a, int b) {
+ *     return a - env->threshold > b;
+ *   }
+ *
+ *   cmp_env e = { 10 };
+ *   cmp_closure above = closure(cmp_closure, above_fn, &e);
+ *   if (closure_call(above, x, y)) ...
+ * @endcode
+ */
+#define closure(type, fn, env_ptr) ((type){ (fn), (env_ptr) })
+
+/**
+ * @brief Call a fat closure with its environment.
+ *
+ * @param c    The closure.
+ * @param ...  Arguments of the call, environment excluded.
+ */
+#define closure_call(c, ...) ((c).fn((c).env __VA_OPT__(,) __VA_ARGS__))
+
+/** Capacity of a growable array at its first allocation. */
+#ifndef LAMBDA_VEC_INITIAL
+#define LAMBDA_VEC_INITIAL 64
+#endif
+
+/**
+ * @brief Declare a growable array type: a heap buffer whose capacity 
+ * doubles when it is full.
+ *
+ * A growable array must be initialized with LC_VEC_INIT. Its elements 
+ * are `data[0]` to `data[size - 1]`, so it can be given to the array 
+ * constructs directly.
+ *
+ * @param type  Type of the elements.
+ *
+ * Usage:
+ * @code
+ *   typedef vec_t(Node*) node_vec;
+ *   node_vec nodes = LC_VEC_INIT;
+ *   vec_push(&nodes, head);
+ *   long sum = fold(long, Node*, nodes.data, nodes.size, 
+ *      { return acc + value->data; }, 0);
+ *   vec_free(&nodes);
+ * @endcode
+ */
+#define vec_t(type) struct { type *data; size_t size; size_t capacity; }
+
+#define LC_VEC_INIT { NULL, 0, 0 }
+
+/**
+ * @brief Append an element to a growable array.
+ *
+ * The program is aborted if the buffer cannot be grown.
+ *
+ * @param vec   Pointer to the growable array.
+ * @param item  The element to append.
+ */
+#define vec_push(vec, item) ({                                  \
+  __typeof__(vec) _lc_vec = (vec);                              \
+  if(_lc_vec->size == _lc_vec->capacity) {                      \
+    _lc_vec->capacity = _lc_vec->capacity                       \
+      ? 2 * _lc_vec->capacity : LAMBDA_VEC_INITIAL;             \
+    _lc_vec->data = realloc(_lc_vec->data,                      \
+      _lc_vec->capacity * sizeof(*_lc_vec->data));              \
+    if(!_lc_vec->data) abort();                                 \
+  }                                                             \
+  _lc_vec->data[_lc_vec->size++] = (item); })
+
+/**
+ * @brief Release the buffer of a growable array, leaving it empty.
+ *
+ * @param vec   Pointer to the growable array.
+ */
+#define vec_free(vec) ({                                        \
+  __typeof__(vec) _lc_vec = (vec);                              \
+  free(_lc_vec->data);                                          \
+  _lc_vec->data = NULL;                                         \
+  _lc_vec->size = _lc_vec->capacity = 0; })
+
+/**
+ * @brief Operator tags, given to fold in place of a lambda body.
+ *
+ * fold(acc_type, element_type, in_array, size, LC_ADD, init_acc) sums
+ * the elements. When acc_type and element_type are the same primitive
+ * type (char, short, int, long, long long, signed or unsigned, float or
+ * double), a tagged fold runs a kernel of lambda_simd.h, with several
+ * accumulators, vector instructions for int, float and double sums,
+ * minimums and maximums, and no call per element. Integer sums and
+ * products wrap around; floating point sums and products are
+ * reassociated, so their rounding may differ from a sequential fold.
+ * Other type pairs (a long sum of int, for instance) get a plain loop.
+ */
+#define LC_ADD (add)
+#define LC_MUL (mul)
+#define LC_MIN (min)
+#define LC_MAX (max)
+#define LC_XOR (xor)
+
+/* The operators behind the tags. */
+#define _LC_OP_add(acc, value) ((acc) + (value))
+#define _LC_OP_mul(acc, value) ((acc) * (value))
+#define _LC_OP_min(acc, value) ((value) < (acc) ? (value) : (acc))
+#define _LC_OP_max(acc, value) ((value) > (acc) ? (value) : (acc))
+#define _LC_OP_xor(acc, value) ((acc) ^ (value))
+
 /**
  * @brief Performs a fold (also known as reduce) operation on 
  * an array of a specified type.
@@ -78,6 +282,9 @@
  * Body:
  *   The lambda body should process the current element (referenced 
  *   by `value`) and the current accumulator (referenced by `acc`).
+ *   The position of the element is available, read-only, as `index`.
+ *   An operator tag (LC_ADD, LC_MUL, LC_MIN, LC_MAX, LC_XOR) may be
+ *   given instead of a body.
  * 
  * Usage:
  * @code
@@ -87,12 +294,148 @@
  *   printf("Sum = %d\n", 
  *      fold(int, int, numbers, 5, { return acc + value; }, 0));
  *   
+ *   // The same sum, computed by a specialized kernel.
+ *   printf("Sum = %d\n", fold(int, int, numbers, 5, LC_ADD, 0));
  * @endcode
  */
-#define fold(acc_type, element_type, in_array, size, body, init_acc) ({ \
+#define fold(acc_type, element_type, in_array, size, body, init_acc) \
+  _LC_CAT(_fold_, _LC_IS_PAREN(body))(acc_type, element_type, in_array, size, body, init_acc)
+
+#define _fold_0(acc_type, element_type, in_array, size, body, init_acc) \
+  _fold_range(acc_type, element_type, in_array, 0, size, body, init_acc)
+#define _fold_1(acc_type, element_type, in_array, size, tag, init_acc) \
+  _fold_op(acc_type, element_type, in_array, size, _LC_STRIP tag, init_acc)
+
+/*
+ * fold with an operator: the kernel of lambda_simd.h matching both types,
+ * or else a loop applying the operator. Both are nested or plain
+ * functions called directly through _Generic, so no trampoline is needed.
+ */
+#define _fold_op(acc_type, element_type, in_array, size, op, init_acc) \
+  _fold_op_(acc_type, element_type, in_array, size, op, init_acc)
+#define _fold_op_(acc_type, element_type, in_array, size, op, init_acc) ({ \
+  acc_type _lc_loop_##op(const element_type *_lc_a, lc_index_t _lc_n, acc_type acc) { \
+    for(lc_index_t _lc_i=0;_lc_i<_lc_n;_lc_i++)             \
+      acc = _LC_OP_##op(acc, _lc_a[_lc_i]);                 \
+    return acc;                                             \
+  }                                                         \
+  _Generic((acc_type (*)(element_type))0,                   \
+    _LC_KERNELS_##op, default: _lc_loop_##op)               \
+    (&(in_array)[0], size, init_acc); })
+
+/* fold over the elements of in_array from index lo (included) to hi (excluded). */
+#define _fold_range(acc_type, element_type, in_array, lo, hi, body, init_acc) ({ \
+  acc_type acc = init_acc;                                  \
+  const lc_index_t _lc_end = (hi);                          \
+  _𝛌_bind(_𝛌_body, acc_type, (element_type value,           \
+    const lc_index_t index __attribute__((unused))), body); \
+  for(lc_index_t _lc_i=(lo);_lc_i<_lc_end;_lc_i++)          \
+    acc=_𝛌_body(in_array[_lc_i], _lc_i);                    \
+  ; acc; })
+
+/**
+ * @brief Performs a fold operation on an array with the body 
+ * expanded directly into the loop.
+ * 
+ * Unlike fold, no nested function is created and no call is made 
+ * per element: the body is a statement expression evaluated in place, 
+ * so GCC is free to unroll and vectorize the loop.
+ * 
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array on which the fold operation is to be performed.
+ * @param size          The number of elements in the input array.
+ * @param body          A block whose last expression statement is the next 
+ *                      accumulator value.
+ * @param init_acc      The initial value of the accumulator.
+ * 
+ * Body:
+ *   As for fold, the body reads the current element (`value`), its 
+ *   position (`index`) and the current accumulator (`acc`). Being 
+ *   expanded in place, it must not `return`: its value is the one of 
+ *   its last expression statement.
+ * 
+ * Usage:
+ * @code
+ *   double sum = fold_inline(double, double, numbers, n, { acc + value; }, 0.0);
+ * @endcode
+ */
+#define fold_inline(acc_type, element_type, in_array, size, body, init_acc) ({ \
   acc_type acc = init_acc;                                  \
-  for(int i=0;i<size;i++)                                   \
-    acc=𝛌(acc_type,(element_type value), body)(in_array[i]);\
+  const lc_index_t _lc_end = (size);                        \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++) {           \
+    element_type value __attribute__((unused)) = in_array[_lc_i];\
+    const lc_index_t index __attribute__((unused)) = _lc_i; \
+    acc = (body);                                           \
+  }                                                         \
+  ; acc; })
+
+/**
+ * @brief Performs an inclusive scan (prefix fold) on an array.
+ *
+ * Same contract as fold, but every intermediate accumulator is kept:
+ * out_array[i] receives the accumulator once the element i has been
+ * folded. The final accumulator is returned.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body computing the next accumulator
+ *                      from `acc` and `value` (at position `index`), as in fold.
+ * @param init_acc      The initial value of the accumulator.
+ * @param out_array     The output array of `size` accumulators. It may be
+ *                      in_array when both types are the same.
+ *
+ * Usage:
+ * @code
+ *   int numbers[] = {1, 2, 3, 4, 5};
+ *   int totals[5];
+ *   scan(int, int, numbers, 5, { return acc + value; }, 0, totals);
+ *   // totals contains {1, 3, 6, 10, 15}
+ * @endcode
+ */
+#define scan(acc_type, element_type, in_array, size, body, init_acc, out_array) \
+  _scan_range(acc_type, element_type, in_array, 0, size, body, init_acc, out_array, 1)
+
+/**
+ * @brief Performs an exclusive scan (prefix fold) on an array.
+ *
+ * As scan, but out_array[i] receives the accumulator before the element
+ * i is folded: out_array[0] is init_acc. With a sum, this turns record
+ * lengths into record offsets. The final accumulator is returned.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body, as in scan.
+ * @param init_acc      The initial value of the accumulator.
+ * @param out_array     The output array of `size` accumulators. It may be
+ *                      in_array when both types are the same.
+ *
+ * Usage:
+ * @code
+ *   size_t offsets[n];
+ *   size_t total = exscan(size_t, size_t, lengths, n,
+ *      { return acc + value; }, 0, offsets);
+ * @endcode
+ */
+#define exscan(acc_type, element_type, in_array, size, body, init_acc, out_array) \
+  _scan_range(acc_type, element_type, in_array, 0, size, body, init_acc, out_array, 0)
+
+/* scan the elements of in_array from index lo (included) to hi (excluded). */
+#define _scan_range(acc_type, element_type, in_array, lo, hi, body, init_acc, out_array, inclusive) ({ \
+  acc_type acc = init_acc;                                  \
+  const lc_index_t _lc_end = (hi);                          \
+  _𝛌_bind(_𝛌_body, acc_type, (element_type value,           \
+    const lc_index_t index __attribute__((unused))), body); \
+  for(lc_index_t _lc_i=(lo);_lc_i<_lc_end;_lc_i++) {        \
+    element_type _lc_v = in_array[_lc_i];                   \
+    if (!(inclusive)) out_array[_lc_i] = acc;               \
+    acc = _𝛌_body(_lc_v, _lc_i);                            \
+    if (inclusive) out_array[_lc_i] = acc;                  \
+  }                                                         \
   ; acc; })
 
 /**
@@ -140,9 +483,11 @@
  */
 #define fold_s(acc_type, element_type, first_e, next, body, init_acc) ({\
   acc_type acc = init_acc;                        \
-  for(element_type value=first_e; value!=NULL;    \
-      value=𝛌(element_type, (), next)())          \
-      acc=𝛌(acc_type,(), body)();                 \
+  element_type value = first_e;                   \
+  _𝛌_bind(_𝛌_next, element_type, (), next);       \
+  _𝛌_bind(_𝛌_body, acc_type, (), body);           \
+  for(; value!=NULL; value=_𝛌_next())             \
+      acc=_𝛌_body();                              \
   ; acc; })
 
 /**
@@ -167,10 +512,263 @@
  * @endcode
  */
 #define foreach_s(element_type, first_e, body) ({ \
-  for(element_type value=first_e; value!=NULL;    \
-    value=𝛌(element_type, (), body)())            \
+  element_type value = first_e;                   \
+  _𝛌_bind(_𝛌_body, element_type, (), body);       \
+  for(; value!=NULL; value=_𝛌_body())             \
   ; })
 
+/**
+ * @brief Performs fold_s while prefetching the elements ahead.
+ *
+ * A lookahead cursor walks the structure `distance` elements ahead of
+ * the body and prefetches each element it reaches, so that the cache
+ * miss of every dependent load overlaps with the work of the body on
+ * the previous elements. The elements between the cursor and the body
+ * are kept in a ring of `distance` entries on the stack.
+ *
+ * Since the cursor calls `next` in advance, the body must not change
+ * the links of the structure; it may however free `value`.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body, as in fold_s.
+ * @param init_acc      The initial value of the accumulator.
+ * @param distance      The number of elements walked ahead (8 to 16 is a
+ *                      good start, more for short bodies).
+ *
+ * Usage:
+ * @code
+ *   long sum = fold_s_prefetch(long, Node*, head,
+ *      { return value->next; },
+ *      { return acc + value->data; }, 0, 8);
+ * @endcode
+ */
+#define fold_s_prefetch(acc_type, element_type, first_e, next, body, init_acc, distance) ({\
+  acc_type acc = init_acc;                        \
+  element_type value;                             \
+  _𝛌_bind(_𝛌_body, acc_type, (), body);           \
+  _s_prefetch_walk(element_type, first_e, next, distance, acc=_𝛌_body();) \
+  ; acc; })
+
+/**
+ * @brief Iterate over each element of a linked structure while
+ * prefetching the elements ahead.
+ *
+ * As fold_s_prefetch, a lookahead cursor walks `distance` elements
+ * ahead and prefetches them. Unlike foreach_s, finding the next element
+ * is therefore separated from the body, which returns nothing. The
+ * body may free `value`, but must not change the links of the structure.
+ *
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body processing `value`.
+ * @param distance      The number of elements walked ahead.
+ *
+ * Usage:
+ * @code
+ *   foreach_s_prefetch(Node*, head, { return value->next; },
+ *      { free(value); }, 8);
+ * @endcode
+ */
+#define foreach_s_prefetch(element_type, first_e, next, body, distance) ({ \
+  element_type value;                             \
+  _𝛌_bind(_𝛌_body, void, (), body);               \
+  _s_prefetch_walk(element_type, first_e, next, distance, _𝛌_body();) \
+  ; })
+
+/**
+ * @brief Gather the elements of a linked structure into a growable array.
+ *
+ * The elements (typically node pointers) are appended in order to 
+ * out_vec. Repeated traversals can then run the array constructs over 
+ * the gathered elements instead of chasing the links each time: their 
+ * addresses being known, the loads of several elements can overlap.
+ *
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param out_vec       Pointer to a growable array of element_type, 
+ *                      declared with vec_t.
+ *
+ * Returns the number of gathered elements.
+ *
+ * Usage:
+ * @code
+ *   typedef vec_t(Node*) node_vec;
+ *   node_vec nodes = LC_VEC_INIT;
+ *   collect_s(Node*, head, { return value->next; }, &nodes);
+ *   long sum = fold(long, Node*, nodes.data, nodes.size, 
+ *      { return acc + value->data; }, 0);
+ *   vec_free(&nodes);
+ * @endcode
+ */
+#define collect_s(element_type, first_e, next, out_vec) ({ \
+  __typeof__(out_vec) _lc_out = (out_vec);        \
+  size_t _lc_first = _lc_out->size;               \
+  element_type value = first_e;                   \
+  _𝛌_bind(_𝛌_next, element_type, (), next);       \
+  for(; value!=NULL; value=_𝛌_next())             \
+    vec_push(_lc_out, value);                     \
+  _lc_out->size - _lc_first; })
+
+/**
+ * @brief Record every `stride`-th element of a linked structure as a
+ * split point.
+ *
+ * The first element, then every `stride`-th one, is appended to the
+ * vector. The segments between consecutive split points can then be
+ * folded independently, by pfold_s_splits for instance, as long as the
+ * links of the structure do not change. Returns the number of recorded
+ * split points.
+ *
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param stride        The number of elements between two split points.
+ * @param out_vec       Pointer to a vec_t of element_type.
+ *
+ * Usage:
+ * @code
+ *   typedef vec_t(Node *) node_vec;
+ *   node_vec splits = LC_VEC_INIT;
+ *   split_s(Node *, head, { return value->next; }, 1024, &splits);
+ * @endcode
+ */
+#define split_s(element_type, first_e, next, stride, out_vec) ({ \
+  __typeof__(out_vec) _lc_out = (out_vec);        \
+  size_t _lc_first = _lc_out->size;               \
+  const lc_index_t _lc_stride = (stride) < 1 ? 1 : (stride); \
+  lc_index_t _lc_k = 0;                           \
+  element_type value = first_e;                   \
+  _𝛌_bind(_𝛌_next, element_type, (), next);       \
+  for(; value!=NULL; value=_𝛌_next(), _lc_k++)    \
+    if (_lc_k % _lc_stride == 0)                  \
+      vec_push(_lc_out, value);                   \
+  _lc_out->size - _lc_first; })
+
+/*
+ * fold_s from first (included) up to end (excluded, NULL for the whole
+ * structure). The bodies are nested functions called directly, even
+ * with trampolines: run inside a chunk of lambda_parallel.h, a
+ * trampoline would share its cache line with acc and value, and each of
+ * their writes would flush the pipeline as self-modifying code.
+ */
+#define _fold_s_range(acc_type, element_type, first, end, next, body, init_acc) ({\
+  acc_type acc = init_acc;                        \
+  element_type value = first;                     \
+  element_type const _lc_end = end;               \
+  element_type _𝛌_next(void) next                 \
+  acc_type _𝛌_body(void) body                     \
+  for(; value!=_lc_end; value=_𝛌_next())          \
+      acc=_𝛌_body();                              \
+  ; acc; })
+
+/** Largest batch of fold_s_batch (two buffers of it live on the stack). */
+#ifndef LAMBDA_BATCH_MAX
+#define LAMBDA_BATCH_MAX 256
+#endif
+
+/**
+ * @brief Performs fold_s by batches of elements, gathering the next
+ * batch while the body runs over the current one.
+ *
+ * The elements are gathered `batch` at a time into one of two buffers on
+ * the stack. While the body runs over the elements of one buffer, each
+ * of its steps also moves a cursor one link further and stores the
+ * element it reaches into the other buffer. The cache miss of each link
+ * thus overlaps with the work of the body, instead of following it.
+ * When the body costs about as much as a cache miss or more, this beats
+ * fold_s; with a cheap body both are bound by the latency of the links.
+ * The bodies are nested functions called directly, as in _fold_s_range.
+ *
+ * Since the cursor runs ahead of the body, the body must not change the
+ * links of the structure.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body, as in fold_s.
+ * @param init_acc      The initial value of the accumulator.
+ * @param batch         The number of elements per batch, from 1 to
+ *                      LAMBDA_BATCH_MAX (clamped; 16 is a good start).
+ *
+ * Usage:
+ * @code
+ *   long sum = fold_s_batch(long, Node*, head,
+ *      { return value->next; },
+ *      { return acc + value->data; }, 0, 16);
+ * @endcode
+ */
+#define fold_s_batch(acc_type, element_type, first_e, next, body, init_acc, batch) ({\
+  acc_type acc = init_acc;                        \
+  element_type value = first_e;                   \
+  element_type _𝛌_next(void) next                 \
+  acc_type _𝛌_body(void) body                     \
+  const lc_index_t _lc_b = (batch) < 1 ? 1 :      \
+    (batch) > LAMBDA_BATCH_MAX ? LAMBDA_BATCH_MAX : (batch); \
+  element_type _lc_buf[2][_lc_b];                 \
+  element_type _lc_cursor = value;                \
+  lc_index_t _lc_n = 0;                           \
+  int _lc_cur = 0;                                \
+  for(; _lc_n<_lc_b && _lc_cursor!=NULL; _lc_n++) { \
+    _lc_buf[0][_lc_n] = value = _lc_cursor;       \
+    _lc_cursor = _𝛌_next();                       \
+  }                                               \
+  while(_lc_n) {                                  \
+    element_type *_lc_run = _lc_buf[_lc_cur];     \
+    element_type *_lc_fill = _lc_buf[!_lc_cur];   \
+    lc_index_t _lc_m = 0;                         \
+    for(lc_index_t _lc_k=0;_lc_k<_lc_n;_lc_k++) { \
+      if (_lc_cursor!=NULL) {                     \
+        _lc_fill[_lc_m++] = value = _lc_cursor;   \
+        _lc_cursor = _𝛌_next();                   \
+      }                                           \
+      value = _lc_run[_lc_k];                     \
+      acc = _𝛌_body();                            \
+    }                                             \
+    _lc_n = _lc_m;                                \
+    _lc_cur = !_lc_cur;                           \
+  }                                               \
+  ; acc; })
+
+/*
+ * Set `value` to each element of a linked structure in turn and run
+ * `visit`, with a cursor prefetching `distance` elements ahead. `next`
+ * is bound a second time with `value` as parameter, so that the same
+ * body finds the element following any other one.
+ */
+#define _s_prefetch_walk(element_type, first_e, next, distance, visit) { \
+  _𝛌_bind(_𝛌_step, element_type, (element_type value), next);    \
+  const lc_index_t _lc_d = (distance) < 1 ? 1 : (distance);      \
+  element_type _lc_ring[_lc_d];                                  \
+  element_type _lc_ahead = first_e;                              \
+  lc_index_t _lc_n = 0, _lc_head = 0;                            \
+  for(; _lc_n < _lc_d && _lc_ahead != NULL; _lc_n++) {           \
+    _lc_ring[_lc_n] = _lc_ahead;                                 \
+    _lc_ahead = _𝛌_step(_lc_ahead);                              \
+    if(_lc_ahead != NULL) __builtin_prefetch(_lc_ahead);         \
+  }                                                              \
+  while(_lc_n) {                                                 \
+    value = _lc_ring[_lc_head];                                  \
+    if(_lc_ahead != NULL) {                                      \
+      _lc_ring[_lc_head] = _lc_ahead;                            \
+      _lc_ahead = _𝛌_step(_lc_ahead);                            \
+      if(_lc_ahead != NULL) __builtin_prefetch(_lc_ahead);       \
+    } else _lc_n--;                                              \
+    _lc_head = _lc_head + 1 == _lc_d ? 0 : _lc_head + 1;         \
+    visit                                                        \
+  }                                                              \
+}
+
 /**
  * @brief Performs a map operation on arrays of a specified type.
  * 
@@ -188,8 +786,9 @@
  * @param body      The lambda function body responsible 
  *                  for processing each element. 
  *                  It should accept the current element 
- *                  (referenced by `value`) and return the 
- *                  transformed or processed value.
+ *                  (referenced by `value`, its position being 
+ *                  `index`) and return the transformed or 
+ *                  processed value.
  * @param out_array The output array where the transformed/processed 
  *                  elements will be stored.
  * 
@@ -204,11 +803,455 @@
  *   // Now, squared contains {1, 4, 9, 16, 25}
  * @endcode
  */
-#define map(type, in_array, size, body, out_array) ({     \
-  for(int i=0;i<size;i++) {                               \
-    out_array[i]=𝛌(type,(type value), body)(in_array[i]); \
+#define map(type, in_array, size, body, out_array) \
+  _map_range(type, in_array, 0, size, body, out_array)
+
+/* map the elements of in_array from index lo (included) to hi (excluded). */
+#define _map_range(type, in_array, lo, hi, body, out_array) \
+  _map_to_range(type, type, in_array, lo, hi, body, out_array)
+
+#define _map_to_range(in_type, out_type, in_array, lo, hi, body, out_array) ({ \
+  const lc_index_t _lc_end = (hi);                        \
+  _𝛌_bind(_𝛌_body, out_type, (in_type value,              \
+    const lc_index_t index __attribute__((unused))), body);\
+  for(lc_index_t _lc_i=(lo);_lc_i<_lc_end;_lc_i++) {      \
+    out_array[_lc_i]=_𝛌_body(in_array[_lc_i], _lc_i);     \
+  }; })
+
+/**
+ * @brief Performs a map operation from an array of one type to an 
+ * array of another type.
+ * 
+ * Same as map, but the body receives an `in_type` value and returns 
+ * an `out_type` one, so a conversion does not need a pass of its own.
+ * 
+ * @param in_type   The type of the elements in the input array.
+ * @param out_type  The type of the elements in the output array.
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ * @param body      The lambda function body transforming `value` 
+ *                  (at position `index`), as in map.
+ * @param out_array The output array.
+ * 
+ * Usage:
+ * @code
+ *   double ratios[5];
+ *   map_to(int, double, arr, 5, { return value / 5.0; }, ratios);
+ * @endcode
+ */
+#define map_to(in_type, out_type, in_array, size, body, out_array) \
+  _map_to_range(in_type, out_type, in_array, 0, size, body, out_array)
+
+/**
+ * @brief Performs a map operation on an array, overwriting each 
+ * element with its transformed value.
+ * 
+ * No second array is needed, which halves the memory footprint and 
+ * the cache traffic of map when the input is no longer needed. Each 
+ * element is read before being overwritten, and the body should not 
+ * read the other elements of the array.
+ * 
+ * @param type      The type of the elements in the array.
+ * @param array     The array to transform.
+ * @param size      The number of elements in the array.
+ * @param body      The lambda function body transforming `value` 
+ *                  (at position `index`), as in map.
+ * 
+ * Usage:
+ * @code
+ *   map_inplace(int, arr, 5, { return value * value; });
+ * @endcode
+ */
+#define map_inplace(type, array, size, body) ({           \
+  type *_lc_array = &(array)[0];                          \
+  map(type, _lc_array, size, body, _lc_array); })
+
+/**
+ * @brief Performs a map operation on an array with the body 
+ * expanded directly into the loop.
+ * 
+ * The inline counterpart of map: the body is evaluated in place 
+ * as a statement expression, so the loop can be unrolled and 
+ * vectorized.
+ * 
+ * @param type      The type of the elements in the array.
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ * @param body      A block whose last expression statement is the 
+ *                  transformed value of `value`. It must not `return`.
+ * @param out_array The output array.
+ * 
+ * Usage:
+ * @code
+ *   map_inline(double, in, n, { value * 2.0 + 1.0; }, out);
+ * @endcode
+ */
+#define map_inline(type, in_array, size, body, out_array) ({ \
+  const lc_index_t _lc_end = (size);                      \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++) {         \
+    type value __attribute__((unused)) = in_array[_lc_i]; \
+    const lc_index_t index __attribute__((unused)) = _lc_i;\
+    out_array[_lc_i] = (body);                            \
   }; })
 
+/**
+ * @brief Performs a map then a fold on an array in a single pass.
+ *
+ * Equivalent to a map into a temporary array followed by a fold over
+ * it, without the temporary array: each element is transformed and
+ * immediately accumulated, so it is read only once and nothing is
+ * written to memory.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param map_type      The type of the transformed elements.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param map_body      The lambda function body transforming `value` (of
+ *                      element_type), as in map.
+ * @param fold_body     The lambda function body accumulating the
+ *                      transformed `value` (of map_type) into `acc`, as in fold.
+ * @param init_acc      The initial value of the accumulator.
+ *
+ * Both bodies see the position of the element as `index`.
+ *
+ * Usage:
+ * @code
+ *   // Sum of squares
+ *   double norm2 = map_fold(double, double, double, v, n,
+ *      { return value * value; },
+ *      { return acc + value; }, 0.0);
+ * @endcode
+ */
+#define map_fold(acc_type, element_type, map_type, in_array, size, map_body, fold_body, init_acc) \
+  _map_fold_range(acc_type, element_type, map_type, in_array, 0, size, map_body, fold_body, init_acc)
+
+/* map_fold over the elements of in_array from index lo (included) to hi (excluded). */
+#define _map_fold_range(acc_type, element_type, map_type, in_array, lo, hi, map_body, fold_body, init_acc) ({ \
+  acc_type acc = init_acc;                                  \
+  const lc_index_t _lc_end = (hi);                          \
+  _𝛌_bind(_𝛌_map, map_type, (element_type value,            \
+    const lc_index_t index __attribute__((unused))), map_body);\
+  _𝛌_bind(_𝛌_body, acc_type, (map_type value,               \
+    const lc_index_t index __attribute__((unused))), fold_body);\
+  for(lc_index_t _lc_i=(lo);_lc_i<_lc_end;_lc_i++)          \
+    acc=_𝛌_body(_𝛌_map(in_array[_lc_i], _lc_i), _lc_i);     \
+  ; acc; })
+
+/**
+ * @brief Copies the elements of an array satisfying a predicate.
+ *
+ * The kept elements are packed, in order, at the start of out_array,
+ * and their number is returned. The compaction is branchless: every
+ * element is written at the current output position, which only
+ * advances when the predicate holds, so unpredictable predicates do
+ * not cost branch mispredictions.
+ *
+ * @param type          The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body returning non-zero when
+ *                      `value` (at position `index`) is to be kept.
+ * @param out_array     The output array. It must have room for `size`
+ *                      elements, even if fewer are kept. It may be in_array.
+ *
+ * Usage:
+ * @code
+ *   int evens[n];
+ *   lc_index_t count = filter(int, numbers, n, { return value % 2 == 0; }, evens);
+ * @endcode
+ */
+#define filter(type, in_array, size, body, out_array) ({    \
+  const lc_index_t _lc_end = (size);                        \
+  lc_index_t _lc_n = 0;                                     \
+  _𝛌_bind(_𝛌_body, int, (type value,                        \
+    const lc_index_t index __attribute__((unused))), body); \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++) {           \
+    type _lc_v = in_array[_lc_i];                           \
+    out_array[_lc_n] = _lc_v;                               \
+    _lc_n += !!_𝛌_body(_lc_v, _lc_i);                       \
+  }                                                         \
+  _lc_n; })
+
+/* Parameters `a` to `d` of a zip body, and the elements at _lc_i they take. */
+#define _LC_ZIP_PARAMS_2(ta, tb) \
+  ta a __attribute__((unused)), tb b __attribute__((unused))
+#define _LC_ZIP_PARAMS_3(ta, tb, tc) \
+  _LC_ZIP_PARAMS_2(ta, tb), tc c __attribute__((unused))
+#define _LC_ZIP_PARAMS_4(ta, tb, tc, td) \
+  _LC_ZIP_PARAMS_3(ta, tb, tc), td d __attribute__((unused))
+#define _LC_ZIP_ARGS_2(xa, xb) (xa)[_lc_i], (xb)[_lc_i]
+#define _LC_ZIP_ARGS_3(xa, xb, xc) _LC_ZIP_ARGS_2(xa, xb), (xc)[_lc_i]
+#define _LC_ZIP_ARGS_4(xa, xb, xc, xd) _LC_ZIP_ARGS_3(xa, xb, xc), (xd)[_lc_i]
+#define _LC_ZIP_PARAMS(types) _LC_CAT(_LC_ZIP_PARAMS_, _LC_NARGS types) types
+#define _LC_ZIP_ARGS(types, arrays) _LC_CAT(_LC_ZIP_ARGS_, _LC_NARGS types) arrays
+
+/**
+ * @brief Performs a map operation over 2 to 4 arrays in one pass.
+ *
+ * The body receives the elements at the same position of each input
+ * array as `a`, `b`, `c` and `d`, instead of reading the arrays it
+ * captures at `index` through the frame chain. The body is a nested
+ * function called directly (with or without LAMBDA_NO_TRAMPOLINE): GCC
+ * inlines it and can vectorize the loop over all the streams.
+ *
+ * @param out_type  The type of the elements in the output array.
+ * @param types     The types of the elements of the input arrays, in
+ *                  parentheses.
+ * @param arrays    The input arrays, in parentheses, as many as types.
+ * @param size      The number of elements in each input array.
+ * @param body      The lambda function body computing the output
+ *                  element from `a`, `b`, ... (at position `index`).
+ * @param out_array The output array. It may be one of the input arrays.
+ *
+ * Usage:
+ * @code
+ *   // y = alpha * x + y
+ *   zip_map(double, (double, double), (x, y), n,
+ *      { return alpha * a + b; }, y);
+ * @endcode
+ */
+#define zip_map(out_type, types, arrays, size, body, out_array) ({ \
+  const lc_index_t _lc_end = (size);                        \
+  out_type _𝛌_body(_LC_ZIP_PARAMS(types),                   \
+    const lc_index_t index __attribute__((unused))) body    \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++)             \
+    out_array[_lc_i] = _𝛌_body(_LC_ZIP_ARGS(types, arrays), _lc_i); \
+  ; })
+
+/**
+ * @brief Performs a fold operation over 2 to 4 arrays in one pass.
+ *
+ * As zip_map, the body receives the elements at the same position of
+ * each input array as `a`, `b`, `c` and `d`, with the accumulator `acc`,
+ * and returns the next accumulator.
+ *
+ * @param acc_type  The type of the accumulator variable.
+ * @param types     The types of the elements of the input arrays, in
+ *                  parentheses.
+ * @param arrays    The input arrays, in parentheses, as many as types.
+ * @param size      The number of elements in each input array.
+ * @param body      The lambda function body accumulating `a`, `b`, ...
+ *                  (at position `index`) into `acc`.
+ * @param init_acc  The initial value of the accumulator.
+ *
+ * Usage:
+ * @code
+ *   // Dot product
+ *   double dot = zip_fold(double, (double, double), (x, y), n,
+ *      { return acc + a * b; }, 0.0);
+ * @endcode
+ */
+#define zip_fold(acc_type, types, arrays, size, body, init_acc) ({ \
+  acc_type acc = init_acc;                                  \
+  const lc_index_t _lc_end = (size);                        \
+  acc_type _𝛌_body(_LC_ZIP_PARAMS(types),                   \
+    const lc_index_t index __attribute__((unused))) body    \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++)             \
+    acc = _𝛌_body(_LC_ZIP_ARGS(types, arrays), _lc_i);      \
+  ; acc; })
+
+/*
+ * Index of the first element of in_array for which the body is true
+ * (expect 1) or false (expect 0), size if there is none. As for zip, the
+ * body is a nested function called directly.
+ */
+#define _lc_scan_until(type, in_array, size, body, expect) ({ \
+  const lc_index_t _lc_end = (size);                        \
+  int _𝛌_body(type value,                                   \
+    const lc_index_t index __attribute__((unused))) body    \
+  lc_index_t _lc_i = 0;                                     \
+  while (_lc_i < _lc_end && !_𝛌_body(in_array[_lc_i], _lc_i) != !(expect)) \
+    _lc_i++;                                                \
+  _lc_i; })
+
+/**
+ * @brief Index of the first element of an array satisfying a predicate.
+ *
+ * The scan stops at the first match: unlike a fold, the rest of the
+ * array is not read.
+ *
+ * @param type      The type of the elements in the array.
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ * @param body      The lambda function body returning non-zero when
+ *                  `value` (at position `index`) matches.
+ *
+ * Returns the index of the first match, or `size` if there is none.
+ *
+ * Usage:
+ * @code
+ *   lc_index_t at = index_of(int, numbers, n, { return value < 0; });
+ * @endcode
+ */
+#define index_of(type, in_array, size, body) \
+  _lc_scan_until(type, in_array, size, body, 1)
+
+/**
+ * @brief First element of an array satisfying a predicate.
+ *
+ * Same as index_of, but returns a pointer to the element, or NULL if
+ * there is none.
+ *
+ * Usage:
+ * @code
+ *   Item *item = find(Item, items, n, { return value.id == wanted; });
+ * @endcode
+ */
+#define find(type, in_array, size, body) ({                 \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];       \
+  const lc_index_t _lc_n = (size);                          \
+  lc_index_t _lc_at = _lc_scan_until(type, _lc_in, _lc_n, body, 1); \
+  _lc_at < _lc_n ? &_lc_in[_lc_at] : NULL; })
+
+/**
+ * @brief Whether some element of an array satisfies a predicate,
+ * stopping at the first one that does.
+ *
+ * Usage:
+ * @code
+ *   if (any(double, v, n, { return isnan(value); })) ...
+ * @endcode
+ */
+#define any(type, in_array, size, body) ({                  \
+  const lc_index_t _lc_n = (size);                          \
+  _lc_scan_until(type, in_array, _lc_n, body, 1) < _lc_n; })
+
+/**
+ * @brief Whether every element of an array satisfies a predicate,
+ * stopping at the first one that does not.
+ *
+ * Usage:
+ * @code
+ *   int sorted = all(int, v, n, { return index == 0 || v[index - 1] <= value; });
+ * @endcode
+ */
+#define all(type, in_array, size, body) ({                  \
+  const lc_index_t _lc_n = (size);                          \
+  _lc_scan_until(type, in_array, _lc_n, body, 0) == _lc_n; })
+
+/**
+ * @brief Performs a fold operation on an array that the body can stop.
+ *
+ * As fold, except that the body may set `stop` to non-zero: the value
+ * it returns becomes the accumulator and no further element is read.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body accumulating `value` (at
+ *                      position `index`) into `acc`, and setting `stop`
+ *                      once the result is known.
+ * @param init_acc      The initial value of the accumulator.
+ *
+ * Usage:
+ * @code
+ *   // Sum of the first elements, up to a budget of 100
+ *   int spent = fold_until(int, int, costs, n,
+ *      { if (acc + value > 100) { stop = 1; return acc; } return acc + value; }, 0);
+ * @endcode
+ */
+#define fold_until(acc_type, element_type, in_array, size, body, init_acc) ({ \
+  acc_type acc = init_acc;                                  \
+  int stop = 0;                                             \
+  const lc_index_t _lc_end = (size);                        \
+  acc_type _𝛌_body(element_type value,                      \
+    const lc_index_t index __attribute__((unused))) body    \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end && !stop;_lc_i++)    \
+    acc = _𝛌_body(in_array[_lc_i], _lc_i);                  \
+  ; acc; })
+
+/*
+ * First element of a linked structure for which the body is true
+ * (expect 1) or false (expect 0), NULL if there is none.
+ */
+#define _lc_scan_until_s(element_type, first_e, next, body, expect) ({ \
+  element_type value = first_e;                             \
+  element_type _𝛌_next(void) next                           \
+  int _𝛌_body(void) body                                    \
+  while (value != NULL && !_𝛌_body() != !(expect))          \
+    value = _𝛌_next();                                      \
+  value; })
+
+/**
+ * @brief First element of a linked structure satisfying a predicate,
+ * NULL if there is none.
+ *
+ * The walk stops at the first match.
+ *
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body returning non-zero when
+ *                      `value` matches.
+ *
+ * Usage:
+ * @code
+ *   Node *node = find_s(Node*, head, { return value->next; },
+ *      { return value->data == wanted; });
+ * @endcode
+ */
+#define find_s(element_type, first_e, next, body) \
+  _lc_scan_until_s(element_type, first_e, next, body, 1)
+
+/**
+ * @brief Position of the first element of a linked structure
+ * satisfying a predicate, or the number of elements if there is none.
+ *
+ * The parameters are those of find_s.
+ */
+#define index_of_s(element_type, first_e, next, body) ({    \
+  element_type value = first_e;                             \
+  element_type _𝛌_next(void) next                           \
+  int _𝛌_body(void) body                                    \
+  lc_index_t _lc_k = 0;                                     \
+  for(; value != NULL && !_𝛌_body(); value = _𝛌_next())     \
+    _lc_k++;                                                \
+  _lc_k; })
+
+/**
+ * @brief Whether some element of a linked structure satisfies a
+ * predicate, stopping at the first one that does.
+ *
+ * The parameters are those of find_s.
+ */
+#define any_s(element_type, first_e, next, body) \
+  (_lc_scan_until_s(element_type, first_e, next, body, 1) != NULL)
+
+/**
+ * @brief Whether every element of a linked structure satisfies a
+ * predicate, stopping at the first one that does not.
+ *
+ * The parameters are those of find_s.
+ */
+#define all_s(element_type, first_e, next, body) \
+  (_lc_scan_until_s(element_type, first_e, next, body, 0) == NULL)
+
+/**
+ * @brief Performs fold_s that the body can stop.
+ *
+ * As fold_s, except that the body may set `stop` to non-zero: the value
+ * it returns becomes the accumulator and the walk ends there.
+ *
+ * Usage:
+ * @code
+ *   // Length of the list, counting at most 1000 elements
+ *   int length = fold_until_s(int, Node*, head, { return value->next; },
+ *      { stop = acc + 1 == 1000; return acc + 1; }, 0);
+ * @endcode
+ */
+#define fold_until_s(acc_type, element_type, first_e, next, body, init_acc) ({\
+  acc_type acc = init_acc;                                  \
+  int stop = 0;                                             \
+  element_type value = first_e;                             \
+  element_type _𝛌_next(void) next                           \
+  acc_type _𝛌_body(void) body                               \
+  for(; value != NULL && !stop; value = _𝛌_next())          \
+    acc = _𝛌_body();                                        \
+  ; acc; })
+
 /**
  * @brief Performs a map operation on a linked list of 
  * structures of a specified type.
@@ -221,6 +1264,13 @@
  * The mapping lambda function (`body`) is responsible for 
  * processing each individual element.
  * 
+ * The elements are mapped from the last one to the first one, 
+ * so that `next` is always already mapped. The traversal keeps 
+ * the visited elements in a growable array (see vec_t) rather than 
+ * on the call stack: arbitrarily long structures can be mapped in 
+ * constant stack space. The program aborts if that array cannot 
+ * be allocated.
+ * 
  * @param type        Type of the elements in the structure.
  * @param first_e     Initial element of the structure from 
  *                    where the mapping operation begins.
@@ -231,7 +1281,10 @@
  * @param body        Lambda function body responsible for 
  *                    processing each element from variable "value". 
  *                    It should accept the current element and 
- *                    return the processed value.
+ *                    return the processed value. The variable 
+ *                    "next" holds the processed value of the 
+ *                    following element (or the NULL ending the 
+ *                    structure).
  * 
  * Usage:
  * @code
@@ -254,14 +1307,48 @@
  *   // Now, each node's data in the linked list is squared.
  * @endcode
  */
-#define map_s(type, first_e, findnext, body) ({         \
-  type aux(type value) {                                \
-    if(!value) return value;                            \
-    else {                                              \
-      type next = 𝛌(type, (type next), findnext)(value);\
-      next = aux(next);                                 \
-      return 𝛌(type, (), body)();                       \
-    }                                                   \
-  } ; aux(first_e) ;})
+#define map_s(type, first_e, findnext, body) \
+  _map_s(type, first_e, findnext, body, 0)
+
+/**
+ * @brief Performs map_s while prefetching the elements of its second pass.
+ *
+ * map_s first records the elements, then runs the body over them in
+ * reverse order. Since their addresses are known by then, that second
+ * pass prefetches the element `distance` positions ahead, which pays
+ * off when the structure is too large to stay in cache.
+ *
+ * @param type        Type of the elements in the structure.
+ * @param first_e     Initial element of the structure.
+ * @param findnext    Lambda function body retrieving the next element,
+ *                    as in map_s.
+ * @param body        Lambda function body processing `value`, as in map_s.
+ * @param distance    The number of elements prefetched ahead.
+ */
+#define map_s_prefetch(type, first_e, findnext, body, distance) \
+  _map_s(type, first_e, findnext, body, distance)
+
+/* map_s, prefetching `distance` elements ahead in the second pass (0: none). */
+#define _map_s(type, first_e, findnext, body, distance) ({ \
+  type value = first_e;                                 \
+  type next;                                            \
+  _𝛌_bind(_𝛌_next, type, (type next __attribute__((unused))), findnext);\
+  _𝛌_bind(_𝛌_body, type, (), body);                     \
+  vec_t(type) _lc_stack = LC_VEC_INIT;                  \
+  for(; value; value=_𝛌_next(value))                    \
+    vec_push(&_lc_stack, value);                        \
+  next = value;                                         \
+  const size_t _lc_d = (distance);                      \
+  for(size_t _lc_n = _lc_stack.size; _lc_n; ) {         \
+    if(_lc_d && _lc_n > _lc_d)                          \
+      __builtin_prefetch(_lc_stack.data[_lc_n - 1 - _lc_d]);\
+    value = _lc_stack.data[--_lc_n];                    \
+    next = _𝛌_body();                                   \
+  }                                                     \
+  vec_free(&_lc_stack);                                 \
+  next; })
+
+/* The kernels of the operator tags. */
+#include "lambda_simd.h"
 
 #endif
@@ -0,0 +1,174 @@
+/**
+ * @file lambda_arena.h
+ * @brief Bump allocator for the structures built by LambdaCraft constructs.
+ *
+ * This header file provides a small arena (bump) allocator and variants
+ * of map_s and fold whose body allocates from an arena. Every node of
+ * the resulting structure is then released at once with the arena.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_arena_h
+#define _lambda_arena_h
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "lambda.h"
+
+/** Size in bytes of the first block of an arena. */
+#ifndef LAMBDA_ARENA_BLOCK
+#define LAMBDA_ARENA_BLOCK 4096
+#endif
+
+/* A type with the strictest alignment of the basic types (C99 has no max_align_t). */
+typedef union {
+  long double ld;
+  long long ll;
+  void *p;
+  void (*f)(void);
+} _lc_max_align;
+
+typedef struct _lc_arena_block {
+  struct _lc_arena_block *prev;
+  size_t size;
+  size_t used;
+  _lc_max_align data[];
+} _lc_arena_block;
+
+/**
+ * @brief An arena: a chain of blocks, each one twice as large as the
+ * previous one, carved out by bumping a pointer.
+ *
+ * An arena must be initialized with LC_ARENA_INIT.
+ */
+typedef struct {
+  _lc_arena_block *block;
+} lc_arena;
+
+#define LC_ARENA_INIT { NULL }
+
+/**
+ * @brief Allocate `size` bytes, aligned for any type, from an arena.
+ *
+ * Returns NULL if a new block is needed and cannot be allocated.
+ */
+static inline void *lc_arena_alloc(lc_arena *a, size_t size) {
+  const size_t align = sizeof(_lc_max_align);
+  size = (size + align - 1) / align * align;
+  _lc_arena_block *b = a->block;
+  if (!b || b->size - b->used < size) {
+    size_t n = b ? 2 * b->size : LAMBDA_ARENA_BLOCK;
+    while (n < size) n *= 2;
+    b = malloc(sizeof(_lc_arena_block) + n);
+    if (!b) return NULL;
+    b->prev = a->block;
+    b->size = n;
+    b->used = 0;
+    a->block = b;
+  }
+  void *p = (char *)b->data + b->used;
+  b->used += size;
+  return p;
+}
+
+/**
+ * @brief Release every allocation of an arena at once.
+ *
+ * The list of blocks is walked and each block freed: the cost is
+ * O(number of blocks), whatever the number of allocations, and the
+ * number of blocks grows with the logarithm of the allocated size.
+ * The arena can be reused afterwards.
+ */
+static inline void lc_arena_release(lc_arena *a) {
+  while (a->block) {
+    _lc_arena_block *prev = a->block->prev;
+    free(a->block);
+    a->block = prev;
+  }
+}
+
+/**
+ * @brief Allocate an object of the given type from an arena.
+ */
+#define lc_arena_new(arena, type) ((type *)lc_arena_alloc(arena, sizeof(type)))
+
+/**
+ * @brief Performs map_s with a body allocating from an arena.
+ *
+ * @param type        Type of the elements in the structure.
+ * @param first_e     Initial element of the structure.
+ * @param findnext    Lambda function body retrieving the next element,
+ *                    as in map_s.
+ * @param body        Lambda function body processing `value`, as in map_s.
+ *                    It also sees `arena`, a pointer to the given arena.
+ * @param in_arena    Pointer to the arena the body allocates from.
+ *                    The expression must not use a variable named
+ *                    `arena`, which it would see as the one declared.
+ *
+ * Usage:
+ * @code
+ *   lc_arena nodes = LC_ARENA_INIT;
+ *   Node *squares = map_s_arena(Node*, head, { return value->next; },
+ *    {
+ *      Node *r_value = lc_arena_new(arena, Node);
+ *      r_value->data = value->data * value->data;
+ *      r_value->next = next;
+ *      return r_value;
+ *    }, &nodes);
+ *   ...
+ *   lc_arena_release(&nodes); // frees the whole squares list
+ * @endcode
+ */
+#define map_s_arena(type, first_e, findnext, body, in_arena) ({ \
+  lc_arena *arena __attribute__((unused)) = (in_arena);         \
+  map_s(type, first_e, findnext, body); })
+
+/**
+ * @brief Performs fold on an array with a body allocating from an arena.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body, as in fold. It also sees
+ *                      `arena`, a pointer to the given arena.
+ * @param init_acc      The initial value of the accumulator.
+ * @param in_arena      Pointer to the arena the body allocates from.
+ *                      As for map_s_arena, it must not use `arena`.
+ *
+ * Usage:
+ * @code
+ *   lc_arena nodes = LC_ARENA_INIT;
+ *   Node *list = fold_arena(Node*, int, numbers, n,
+ *    {
+ *      Node *le = lc_arena_new(arena, Node);
+ *      le->data = value;
+ *      le->next = acc;
+ *      return le;
+ *    }, NULL, &nodes);
+ * @endcode
+ */
+#define fold_arena(acc_type, element_type, in_array, size, body, init_acc, in_arena) ({ \
+  lc_arena *arena __attribute__((unused)) = (in_arena);         \
+  fold(acc_type, element_type, in_array, size, body, init_acc); })
+
+#endif
@@ -0,0 +1,594 @@
+/**
+ * @file lambda_hash.h
+ * @brief Open addressing hash tables and per-key aggregation.
+ *
+ * This header file provides hash_table_t, a hash table with linear
+ * probing whose slots hold the key, the value and a tag of the hash side
+ * by side in one array: a lookup usually reads a single cache line. On
+ * top of it, reduce_by_key folds the elements of an array per key, and
+ * preduce_by_key does so on several threads, each one filling a table of
+ * its own before the tables are merged.
+ *
+ * Keys are hashed and compared byte by byte: they may be integers,
+ * pointers or structures without padding, not strings (use a pointer
+ * to an interned string, or a hash of the string, instead), nor
+ * floating point numbers.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_hash_h
+#define _lambda_hash_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lambda.h"
+#include "lambda_parallel.h"
+
+/** Number of slots allocated by the first insertion (a power of two). */
+#ifndef LAMBDA_HASH_INITIAL
+#define LAMBDA_HASH_INITIAL 16
+#endif
+
+/** Rows of the build side per partition of hash_join_radix. */
+#ifndef LAMBDA_JOIN_CLUSTER
+#define LAMBDA_JOIN_CLUSTER 8192
+#endif
+
+/** Maximum number of bits of the partitions of hash_join_radix. */
+#ifndef LAMBDA_JOIN_MAX_BITS
+#define LAMBDA_JOIN_MAX_BITS 12
+#endif
+
+/**
+ * @brief Declare a hash table type mapping key_type to value_type.
+ *
+ * The table grows by doubling once half of its slots are used. A slot
+ * whose tag is 0 is free. Declare the type once with typedef, and
+ * initialize the tables with LC_HASH_INIT.
+ *
+ * Keys are equal when their bytes are. key_type must therefore be an
+ * integer, a pointer or a structure of those without padding: padding
+ * bytes are undefined, so that equal structures could hash apart. Keys
+ * of floating type are rejected at compile time, since -0.0 and 0.0
+ * would be distinct keys and a NaN would equal itself; use an integer
+ * image of the number instead.
+ *
+ * @param key_type    The type of the keys, see above.
+ * @param value_type  The type of the values.
+ *
+ * Usage:
+ * @code
+ *   typedef hash_table_t(int, long) count_table;
+ *   count_table counts = LC_HASH_INIT;
+ * @endcode
+ */
+#define hash_table_t(key_type, value_type) struct {   \
+  struct { uint32_t tag; key_type key; value_type value; } *slots; \
+  size_t size;                                        \
+  size_t capacity;                                    \
+}
+
+#define LC_HASH_INIT { NULL, 0, 0 }
+
+/* 64-bit hash of the bytes of a key (the finalizer of MurmurHash3). */
+static inline uint64_t _lc_hash_bytes(const void *key, size_t size) {
+  const unsigned char *p = key;
+  uint64_t h = size;
+  while (1) {
+    uint64_t w = 0;
+    size_t n = size < 8 ? size : 8;
+    memcpy(&w, p, n);
+    h ^= w;
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    if (size <= 8) return h;
+    p += 8;
+    size -= 8;
+  }
+}
+
+/* Reject keys of floating type, whose equality is not that of their bytes. */
+#define _lc_hash_check_key(k)                                     \
+  _Static_assert(_Generic((k), float: 0, double: 0, long double: 0, default: 1), \
+                 "hash_table_t: floating point keys are not supported")
+
+/* Tag stored in a slot: the high half of the hash, never 0. */
+#define _lc_hash_tag(h) ((uint32_t)((h) >> 32) | 1)
+
+/*
+ * Slot of `key` in the table, inserted (with its value left undefined)
+ * when absent. `inserted` is set to 1 in that case, to 0 otherwise.
+ */
+#define _lc_hash_slot(table, key_expr, inserted) ({               \
+  __typeof__(table) _lc_ht = (table);                             \
+  __typeof__(_lc_ht->slots->key) _lc_hk = (key_expr);             \
+  _lc_hash_check_key(_lc_hk);                                     \
+  if (2 * (_lc_ht->size + 1) > _lc_ht->capacity)                  \
+    _lc_hash_grow(_lc_ht);                                        \
+  uint64_t _lc_h = _lc_hash_bytes(&_lc_hk, sizeof(_lc_hk));       \
+  uint32_t _lc_tag = _lc_hash_tag(_lc_h);                         \
+  size_t _lc_mask = _lc_ht->capacity - 1, _lc_i = _lc_h & _lc_mask; \
+  __typeof__(_lc_ht->slots) _lc_s;                                \
+  for (;; _lc_i = (_lc_i + 1) & _lc_mask) {                       \
+    _lc_s = &_lc_ht->slots[_lc_i];                                \
+    if (_lc_s->tag == 0) {                                        \
+      _lc_s->tag = _lc_tag;                                       \
+      memcpy(&_lc_s->key, &_lc_hk, sizeof(_lc_hk));               \
+      _lc_ht->size++;                                             \
+      (inserted) = 1;                                             \
+      break;                                                      \
+    }                                                             \
+    if (_lc_s->tag == _lc_tag &&                                  \
+        memcmp(&_lc_s->key, &_lc_hk, sizeof(_lc_hk)) == 0) {      \
+      (inserted) = 0;                                             \
+      break;                                                      \
+    }                                                             \
+  }                                                               \
+  _lc_s; })
+
+/* Double the capacity of the table (or allocate it), aborting on failure. */
+#define _lc_hash_grow(table) ({                                   \
+  __typeof__(table) _lc_g = (table);                              \
+  size_t _lc_old = _lc_g->capacity;                               \
+  size_t _lc_cap = _lc_old ? 2 * _lc_old : LAMBDA_HASH_INITIAL;   \
+  __typeof__(_lc_g->slots) _lc_from = _lc_g->slots;               \
+  _lc_g->slots = calloc(_lc_cap, sizeof(*_lc_g->slots));          \
+  if (_lc_g->slots == NULL) {                                     \
+    fprintf(stderr, "hash table: out of memory\n");               \
+    abort();                                                      \
+  }                                                               \
+  _lc_g->capacity = _lc_cap;                                      \
+  for (size_t _lc_j = 0; _lc_j < _lc_old; _lc_j++) {              \
+    if (_lc_from[_lc_j].tag == 0) continue;                       \
+    size_t _lc_p = _lc_hash_bytes(&_lc_from[_lc_j].key,           \
+                     sizeof(_lc_from[_lc_j].key)) & (_lc_cap - 1);\
+    while (_lc_g->slots[_lc_p].tag) _lc_p = (_lc_p + 1) & (_lc_cap - 1); \
+    _lc_g->slots[_lc_p] = _lc_from[_lc_j];                        \
+  }                                                               \
+  free(_lc_from);                                                 \
+  ; })
+
+/**
+ * @brief Number of keys in a hash table.
+ *
+ * @param table  Pointer to a hash table.
+ */
+#define hash_size(table) ((table)->size)
+
+/**
+ * @brief Pointer to the value of a key, inserting the key with
+ * `init_value` when absent.
+ *
+ * The pointer stays valid until the next insertion.
+ *
+ * @param table       Pointer to a hash table.
+ * @param key         The key.
+ * @param init_value  The value given to a key inserted.
+ *
+ * Usage:
+ * @code
+ *   (*hash_upsert(&counts, word_length, 0))++;
+ * @endcode
+ */
+#define hash_upsert(table, key, init_value) ({                    \
+  int _lc_new;                                                    \
+  __typeof__((table)->slots) _lc_u = _lc_hash_slot(table, key, _lc_new); \
+  if (_lc_new) _lc_u->value = (init_value);                       \
+  &_lc_u->value; })
+
+/**
+ * @brief Pointer to the value of a key, NULL when the key is absent.
+ *
+ * @param table  Pointer to a hash table.
+ * @param key    The key.
+ */
+#define hash_find(table, key_expr) ({                             \
+  __typeof__(table) _lc_ft = (table);                             \
+  __typeof__(_lc_ft->slots->key) _lc_fk = (key_expr);             \
+  _lc_hash_check_key(_lc_fk);                                     \
+  __typeof__(&_lc_ft->slots->value) _lc_found = NULL;             \
+  if (_lc_ft->size) {                                             \
+    uint64_t _lc_h = _lc_hash_bytes(&_lc_fk, sizeof(_lc_fk));     \
+    uint32_t _lc_tag = _lc_hash_tag(_lc_h);                       \
+    size_t _lc_mask = _lc_ft->capacity - 1;                       \
+    for (size_t _lc_i = _lc_h & _lc_mask; _lc_ft->slots[_lc_i].tag; \
+         _lc_i = (_lc_i + 1) & _lc_mask)                          \
+      if (_lc_ft->slots[_lc_i].tag == _lc_tag &&                  \
+          memcmp(&_lc_ft->slots[_lc_i].key, &_lc_fk, sizeof(_lc_fk)) == 0) { \
+        _lc_found = &_lc_ft->slots[_lc_i].value;                  \
+        break;                                                    \
+      }                                                           \
+  }                                                               \
+  _lc_found; })
+
+/**
+ * @brief Run a lambda body on each key and value of a hash table, in
+ * no particular order.
+ *
+ * @param table  Pointer to a hash table.
+ * @param body   The lambda function body processing `key` and `value`
+ *               (copies of the slot contents), returning nothing.
+ *
+ * Usage:
+ * @code
+ *   hash_foreach(&counts, { printf("%d: %ld\n", key, value); });
+ * @endcode
+ */
+#define hash_foreach(table, body) ({                              \
+  __typeof__(table) _lc_et = (table);                             \
+  _𝛌_bind(_𝛌_visit, void,                                        \
+    (__typeof__(_lc_et->slots->key) key __attribute__((unused)),  \
+     __typeof__(_lc_et->slots->value) value __attribute__((unused))), body); \
+  for (size_t _lc_i = 0; _lc_i < _lc_et->capacity; _lc_i++)       \
+    if (_lc_et->slots[_lc_i].tag)                                 \
+      _𝛌_visit(_lc_et->slots[_lc_i].key, _lc_et->slots[_lc_i].value); \
+  ; })
+
+/**
+ * @brief Remove every key from a hash table, keeping its slots allocated.
+ *
+ * @param table  Pointer to a hash table.
+ */
+#define hash_clear(table) ({                                      \
+  __typeof__(table) _lc_ct = (table);                             \
+  if (_lc_ct->slots)                                              \
+    memset(_lc_ct->slots, 0, _lc_ct->capacity * sizeof(*_lc_ct->slots)); \
+  _lc_ct->size = 0; })
+
+/**
+ * @brief Release the slots of a hash table, leaving it empty.
+ *
+ * @param table  Pointer to a hash table.
+ */
+#define hash_free(table) ({                                       \
+  __typeof__(table) _lc_xt = (table);                             \
+  free(_lc_xt->slots);                                            \
+  _lc_xt->slots = NULL;                                           \
+  _lc_xt->size = _lc_xt->capacity = 0; })
+
+/*
+ * reduce_by_key over in_array[lo, hi). The bodies are nested functions
+ * called directly, as in _fold_s_range.
+ */
+#define _reduce_by_key_range(key_type, acc_type, element_type, in_array, lo, hi, key_body, fold_body, init_acc, out_table) ({ \
+  __typeof__(out_table) _lc_rt = (out_table);                     \
+  const lc_index_t _lc_end = (hi);                                \
+  acc_type acc;                                                   \
+  key_type _𝛌_key(element_type value __attribute__((unused))) key_body \
+  acc_type _𝛌_body(element_type value __attribute__((unused))) fold_body \
+  for (lc_index_t _lc_i = (lo); _lc_i < _lc_end; _lc_i++) {       \
+    acc_type *_lc_v = hash_upsert(_lc_rt, _𝛌_key(in_array[_lc_i]), init_acc); \
+    acc = *_lc_v;                                                 \
+    *_lc_v = _𝛌_body(in_array[_lc_i]);                            \
+  }                                                               \
+  ; })
+
+/**
+ * @brief Fold the elements of an array per key into a hash table.
+ *
+ * Each element is folded, as in fold, into the accumulator of its key,
+ * which starts from `init_acc` the first time the key is met. Keys
+ * already in the table keep folding from their value, so a table can
+ * aggregate several arrays in turn. Returns the number of keys in the
+ * table.
+ *
+ * @param key_type      The type of the keys: an integer, a pointer or a
+ *                      structure without padding, compared byte by byte
+ *                      (not a floating point number, see hash_table_t).
+ * @param acc_type      The type of the accumulators (the values of the table).
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param key_body      The lambda function body returning the key of `value`.
+ * @param fold_body     The lambda function body computing the next
+ *                      accumulator of the key from `acc` and `value`.
+ * @param init_acc      The initial value of an accumulator.
+ * @param out_table     Pointer to a hash_table_t(key_type, acc_type).
+ *
+ * Usage:
+ * @code
+ *   typedef hash_table_t(int, double) total_table;
+ *   total_table totals = LC_HASH_INIT;
+ *   reduce_by_key(int, double, sale, sales, n,
+ *      { return value.store; },
+ *      { return acc + value.amount; }, 0.0, &totals);
+ * @endcode
+ */
+#define reduce_by_key(key_type, acc_type, element_type, in_array, size, key_body, fold_body, init_acc, out_table) ({ \
+  __typeof__(out_table) _lc_out = (out_table);                    \
+  _reduce_by_key_range(key_type, acc_type, element_type, in_array, \
+    0, size, key_body, fold_body, init_acc, _lc_out);             \
+  hash_size(_lc_out); })
+
+/**
+ * @brief Fold the elements of an array per key using several threads.
+ *
+ * The array is split into `nthreads` contiguous chunks, each reduced by
+ * key into a table of its own on a thread of the pool. The tables are
+ * then merged in chunk order into out_table: the accumulator of a key
+ * new to out_table is copied, otherwise `combine` merges the accumulator
+ * so far (`acc`) with the one of the chunk (`value`), as in pfold.
+ * Returns the number of keys in out_table.
+ *
+ * @param key_type      The type of the keys, as in reduce_by_key.
+ * @param acc_type      The type of the accumulators.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param key_body      The lambda function body returning the key of `value`.
+ * @param fold_body     The lambda function body, as in reduce_by_key.
+ * @param combine       The lambda function body merging two accumulators
+ *                      of the same key.
+ * @param init_acc      The initial value of an accumulator. It must be
+ *                      an identity for combine.
+ * @param out_table     Pointer to a hash_table_t(key_type, acc_type).
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   preduce_by_key(int, double, sale, sales, n,
+ *      { return value.store; },
+ *      { return acc + value.amount; },
+ *      { return acc + value; }, 0.0, &totals, 8);
+ * @endcode
+ */
+#define preduce_by_key(key_type, acc_type, element_type, in_array, size, key_body, fold_body, combine, init_acc, out_table, nthreads) ({ \
+  __typeof__(out_table) _lc_out = (out_table);                    \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];             \
+  lc_index_t _lc_size = (size);                                   \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                   \
+  __typeof__(*_lc_out) _lc_tables[_lc_nt];                        \
+  void _𝛌_chunk(int _lc_t) {                                      \
+    lc_index_t _lc_lo = _lc_size * _lc_t / _lc_nt;                \
+    lc_index_t _lc_hi = _lc_size * (_lc_t + 1) / _lc_nt;          \
+    _lc_tables[_lc_t] = (__typeof__(*_lc_out))LC_HASH_INIT;       \
+    _reduce_by_key_range(key_type, acc_type, element_type, _lc_in, \
+      _lc_lo, _lc_hi, key_body, fold_body, init_acc, &_lc_tables[_lc_t]); \
+  }                                                               \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                 \
+  acc_type acc;                                                   \
+  _𝛌_bind(_𝛌_combine, acc_type,                                  \
+    (acc_type value __attribute__((unused))), combine);           \
+  for (int _lc_t = 0; _lc_t < _lc_nt; _lc_t++) {                  \
+    for (size_t _lc_j = 0; _lc_j < _lc_tables[_lc_t].capacity; _lc_j++) { \
+      if (_lc_tables[_lc_t].slots[_lc_j].tag == 0) continue;      \
+      int _lc_new;                                                \
+      __typeof__(_lc_out->slots) _lc_m = _lc_hash_slot(_lc_out,   \
+        _lc_tables[_lc_t].slots[_lc_j].key, _lc_new);             \
+      if (_lc_new) {                                              \
+        _lc_m->value = _lc_tables[_lc_t].slots[_lc_j].value;      \
+      } else {                                                    \
+        acc = _lc_m->value;                                       \
+        _lc_m->value = _𝛌_combine(_lc_tables[_lc_t].slots[_lc_j].value); \
+      }                                                           \
+    }                                                             \
+    hash_free(&_lc_tables[_lc_t]);                                \
+  }                                                               \
+  hash_size(_lc_out); })
+
+/* End of a chain of build rows with the same key. */
+#define _LC_JOIN_END ((lc_index_t)-1)
+
+/*
+ * Join pass: a table maps each key of the build side to its first row,
+ * _lc_next chains the rows sharing a key in ascending order, then each
+ * row of the probe side walks the chain of its key. `emit` is run with
+ * _lc_b and _lc_p, the indexes of the build and probe rows.
+ */
+#define _lc_join_pass(key_type, build, bn, bkey, probe, pn, pkey, matches, emit) ({ \
+  hash_table_t(key_type, lc_index_t) _lc_heads = LC_HASH_INIT;    \
+  lc_index_t *_lc_next = malloc((bn) * sizeof(lc_index_t) + 1);   \
+  if (_lc_next == NULL) {                                         \
+    fprintf(stderr, "hash_join: out of memory\n");                \
+    abort();                                                      \
+  }                                                               \
+  for (lc_index_t _lc_b = (bn); _lc_b-- > 0;) {                   \
+    lc_index_t *_lc_head = hash_upsert(&_lc_heads, bkey(build[_lc_b]), _LC_JOIN_END); \
+    _lc_next[_lc_b] = *_lc_head;                                  \
+    *_lc_head = _lc_b;                                            \
+  }                                                               \
+  for (lc_index_t _lc_p = 0; _lc_p < (pn); _lc_p++) {             \
+    lc_index_t *_lc_head = hash_find(&_lc_heads, pkey(probe[_lc_p])); \
+    if (_lc_head == NULL) continue;                               \
+    for (lc_index_t _lc_b = *_lc_head; _lc_b != _LC_JOIN_END; _lc_b = _lc_next[_lc_b]) { \
+      emit;                                                       \
+      (matches)++;                                                \
+    }                                                             \
+  }                                                               \
+  free(_lc_next);                                                 \
+  hash_free(&_lc_heads);                                          \
+  ; })
+
+/**
+ * @brief Join two arrays on keys, running a lambda body on each pair of
+ * elements with equal keys.
+ *
+ * A hash table is built from the smaller array and probed with each
+ * element of the other one, in O(lsize + rsize + matches) instead of the
+ * O(lsize * rsize) of nested loops. Pairs are emitted in the order of
+ * the larger array, then of the smaller one. Returns the number of pairs.
+ *
+ * @param key_type      The type of the keys.
+ * @param left_type     The type of the elements in the left array.
+ * @param right_type    The type of the elements in the right array.
+ * @param left_array    The left array.
+ * @param lsize         The number of elements in the left array.
+ * @param right_array   The right array.
+ * @param rsize         The number of elements in the right array.
+ * @param lkey_body     The lambda function body returning the key of `value`,
+ *                      an element of the left array.
+ * @param rkey_body     The lambda function body returning the key of `value`,
+ *                      an element of the right array.
+ * @param emit_body     The lambda function body processing `left` and
+ *                      `right`, two elements with equal keys.
+ *
+ * Usage:
+ * @code
+ *   hash_join(int, order, customer, orders, n, customers, m,
+ *      { return value.customer_id; }, { return value.id; },
+ *      { printf("%s: %d\n", right.name, left.amount); });
+ * @endcode
+ */
+#define hash_join(key_type, left_type, right_type, left_array, lsize, right_array, rsize, lkey_body, rkey_body, emit_body) ({ \
+  __typeof__(&(left_array)[0]) _lc_l = &(left_array)[0];          \
+  __typeof__(&(right_array)[0]) _lc_r = &(right_array)[0];        \
+  lc_index_t _lc_ln = (lsize), _lc_rn = (rsize);                  \
+  key_type _𝛌_lkey(left_type value __attribute__((unused))) lkey_body \
+  key_type _𝛌_rkey(right_type value __attribute__((unused))) rkey_body \
+  void _𝛌_emit(left_type left __attribute__((unused)),            \
+              right_type right __attribute__((unused))) emit_body \
+  size_t _lc_matches = 0;                                         \
+  if (_lc_ln <= _lc_rn)                                           \
+    _lc_join_pass(key_type, _lc_l, _lc_ln, _𝛌_lkey, _lc_r, _lc_rn, _𝛌_rkey, \
+                  _lc_matches, _𝛌_emit(_lc_l[_lc_b], _lc_r[_lc_p])); \
+  else                                                            \
+    _lc_join_pass(key_type, _lc_r, _lc_rn, _𝛌_rkey, _lc_l, _lc_ln, _𝛌_lkey, \
+                  _lc_matches, _𝛌_emit(_lc_l[_lc_p], _lc_r[_lc_b])); \
+  _lc_matches; })
+
+/*
+ * Scatter the keys of an array and their indexes into partitions (a
+ * counting sort). The first pass keeps the key and the partition of each
+ * element in `keys` and `parts`, so that the second pass neither calls
+ * the key body nor hashes again. `fill` has room for one index per
+ * partition.
+ */
+#define _lc_join_scatter(key_type, array, n, keyfn, entries, start, bits, keys, parts, fill) ({ \
+  lc_index_t _lc_n = (n);                                         \
+  for (lc_index_t _lc_i = 0; _lc_i < _lc_n; _lc_i++) {            \
+    keys[_lc_i] = keyfn(array[_lc_i]);                            \
+    parts[_lc_i] = _lc_hash_bytes(&keys[_lc_i], sizeof(key_type)) >> (64 - (bits)); \
+    start[parts[_lc_i] + 1]++;                                    \
+  }                                                               \
+  for (size_t _lc_q = 1; _lc_q <= ((size_t)1 << (bits)); _lc_q++) \
+    start[_lc_q] += start[_lc_q - 1];                             \
+  memcpy(fill, start, ((size_t)1 << (bits)) * sizeof(lc_index_t)); \
+  for (lc_index_t _lc_i = 0; _lc_i < _lc_n; _lc_i++) {            \
+    lc_index_t _lc_at = fill[parts[_lc_i]]++;                     \
+    memcpy(&entries[_lc_at].key, &keys[_lc_i], sizeof(key_type)); \
+    entries[_lc_at].index = _lc_i;                                \
+  }                                                               \
+  ; })
+
+/*
+ * Partitioned join pass: the keys of both sides are scattered with the
+ * index of their row into 2^bits partitions on the high bits of their
+ * hash, so that the table of a partition of the build side stays in
+ * cache while the same partition of the probe side is joined. Without
+ * memory for the partitions, falls back to _lc_join_pass.
+ */
+#define _lc_join_radix_pass(key_type, build, bn, bkey, probe, pn, pkey, matches, emit) ({ \
+  int _lc_bits = 0;                                               \
+  while (_lc_bits < LAMBDA_JOIN_MAX_BITS &&                       \
+         ((lc_index_t)LAMBDA_JOIN_CLUSTER << _lc_bits) < (bn))    \
+    _lc_bits++;                                                   \
+  size_t _lc_parts = (size_t)1 << _lc_bits;                       \
+  struct { key_type key; lc_index_t index; }                      \
+    *_lc_be = malloc((bn) * sizeof(*_lc_be) + 1),                 \
+    *_lc_pe = malloc((pn) * sizeof(*_lc_pe) + 1);                 \
+  lc_index_t *_lc_bstart = calloc(_lc_parts + 1, sizeof(lc_index_t)); \
+  lc_index_t *_lc_pstart = calloc(_lc_parts + 1, sizeof(lc_index_t)); \
+  lc_index_t *_lc_next = malloc((bn) * sizeof(lc_index_t) + 1);   \
+  lc_index_t _lc_most = (bn) > (pn) ? (bn) : (pn);                \
+  key_type *_lc_keys = malloc(_lc_most * sizeof(key_type) + 1);   \
+  uint32_t *_lc_part = malloc(_lc_most * sizeof(uint32_t) + 1);   \
+  lc_index_t *_lc_fill = malloc(_lc_parts * sizeof(lc_index_t));  \
+  if (_lc_bits == 0 || !_lc_be || !_lc_pe || !_lc_bstart || !_lc_pstart || !_lc_next || \
+      !_lc_keys || !_lc_part || !_lc_fill) {                      \
+    free(_lc_be); free(_lc_pe); free(_lc_bstart); free(_lc_pstart); free(_lc_next); \
+    free(_lc_keys); free(_lc_part); free(_lc_fill);               \
+    _lc_join_pass(key_type, build, bn, bkey, probe, pn, pkey, matches, emit); \
+  } else {                                                        \
+    _lc_join_scatter(key_type, build, bn, bkey, _lc_be, _lc_bstart, _lc_bits, \
+                     _lc_keys, _lc_part, _lc_fill);               \
+    _lc_join_scatter(key_type, probe, pn, pkey, _lc_pe, _lc_pstart, _lc_bits, \
+                     _lc_keys, _lc_part, _lc_fill);               \
+    free(_lc_keys); free(_lc_part); free(_lc_fill);               \
+    hash_table_t(key_type, lc_index_t) _lc_heads = LC_HASH_INIT;  \
+    for (size_t _lc_q = 0; _lc_q < _lc_parts; _lc_q++) {          \
+      if (_lc_bstart[_lc_q] == _lc_bstart[_lc_q + 1] ||           \
+          _lc_pstart[_lc_q] == _lc_pstart[_lc_q + 1]) continue;   \
+      hash_clear(&_lc_heads);                                     \
+      for (lc_index_t _lc_i = _lc_bstart[_lc_q + 1]; _lc_i-- > _lc_bstart[_lc_q];) { \
+        lc_index_t *_lc_head = hash_upsert(&_lc_heads, _lc_be[_lc_i].key, _LC_JOIN_END); \
+        _lc_next[_lc_i] = *_lc_head;                              \
+        *_lc_head = _lc_i;                                        \
+      }                                                           \
+      for (lc_index_t _lc_j = _lc_pstart[_lc_q]; _lc_j < _lc_pstart[_lc_q + 1]; _lc_j++) { \
+        lc_index_t *_lc_head = hash_find(&_lc_heads, _lc_pe[_lc_j].key); \
+        if (_lc_head == NULL) continue;                           \
+        lc_index_t _lc_p = _lc_pe[_lc_j].index;                   \
+        for (lc_index_t _lc_i = *_lc_head; _lc_i != _LC_JOIN_END; _lc_i = _lc_next[_lc_i]) { \
+          lc_index_t _lc_b = _lc_be[_lc_i].index;                 \
+          emit;                                                   \
+          (matches)++;                                            \
+        }                                                         \
+      }                                                           \
+    }                                                             \
+    hash_free(&_lc_heads);                                        \
+    free(_lc_be); free(_lc_pe); free(_lc_bstart); free(_lc_pstart); free(_lc_next); \
+  }                                                               \
+  ; })
+
+/**
+ * @brief Join two arrays on keys as hash_join, partitioning them first
+ * so that each hash table fits in cache.
+ *
+ * The keys of both arrays and the indexes of their elements are first
+ * scattered into up to 2^LAMBDA_JOIN_MAX_BITS partitions of about
+ * LAMBDA_JOIN_CLUSTER elements of the smaller array (radix clustering on
+ * the hash of the keys); each partition is then joined with its own
+ * small table. This pays off once the table of the smaller array would
+ * not fit in the caches, typically beyond a million elements; smaller
+ * inputs are joined as by hash_join. Pairs are emitted in no particular
+ * order. Returns the number of pairs.
+ *
+ * The parameters are those of hash_join.
+ *
+ * Usage:
+ * @code
+ *   hash_join_radix(long, click, user, clicks, n, users, m,
+ *      { return value.user_id; }, { return value.id; },
+ *      { count[right.country]++; });
+ * @endcode
+ */
+#define hash_join_radix(key_type, left_type, right_type, left_array, lsize, right_array, rsize, lkey_body, rkey_body, emit_body) ({ \
+  __typeof__(&(left_array)[0]) _lc_l = &(left_array)[0];          \
+  __typeof__(&(right_array)[0]) _lc_r = &(right_array)[0];        \
+  lc_index_t _lc_ln = (lsize), _lc_rn = (rsize);                  \
+  key_type _𝛌_lkey(left_type value __attribute__((unused))) lkey_body \
+  key_type _𝛌_rkey(right_type value __attribute__((unused))) rkey_body \
+  void _𝛌_emit(left_type left __attribute__((unused)),            \
+              right_type right __attribute__((unused))) emit_body \
+  size_t _lc_matches = 0;                                         \
+  if (_lc_ln <= _lc_rn)                                           \
+    _lc_join_radix_pass(key_type, _lc_l, _lc_ln, _𝛌_lkey, _lc_r, _lc_rn, _𝛌_rkey, \
+                        _lc_matches, _𝛌_emit(_lc_l[_lc_b], _lc_r[_lc_p])); \
+  else                                                            \
+    _lc_join_radix_pass(key_type, _lc_r, _lc_rn, _𝛌_rkey, _lc_l, _lc_ln, _𝛌_lkey, \
+                        _lc_matches, _𝛌_emit(_lc_l[_lc_p], _lc_r[_lc_b])); \
+  _lc_matches; })
+
+#endif
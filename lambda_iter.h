@@ -0,0 +1,240 @@
+/**
+ * @file lambda_iter.h
+ * @brief Lazy iterator pipelines fusing map, filter and take into one loop.
+ *
+ * This header file provides pipelines made of a source (an array, a
+ * linked structure or a generator), lazy stages (iter_map, iter_filter,
+ * iter_take) and a terminal (iter_fold, iter_collect, iter_find). The
+ * whole chain runs element by element in a single loop: no stage stores
+ * its results, and the source stops as soon as a stage or the terminal
+ * needs no more elements.
+ *
+ * A pipeline is written from the inside out, each stage taking the
+ * previous one as first argument, in the way map and fold take their
+ * input array first:
+ * @code
+ *   double total = iter_fold(double, double,
+ *      iter_take(double,
+ *        iter_filter(double,
+ *          iter_map(int, double,
+ *            iter_array(int, numbers, n),
+ *            { return value * 0.5; }),
+ *          { return value > 1.0; }),
+ *        10),
+ *      { return acc + value; }, 0.0);
+ * @endcode
+ *
+ * Each element is pushed from the source to the terminal through nested
+ * functions named `_lc_sink`, called directly: every stage defines its
+ * own sink in an inner block, where it shadows the sink of the next stage,
+ * reached through `_lc_up`. A sink returns 0 when no more elements are
+ * wanted.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_iter_h
+#define _lambda_iter_h
+
+#include "lambda.h"
+
+/**
+ * @brief Source pushing the elements of an array.
+ *
+ * @param type   The type of the elements in the array.
+ * @param array  The input array.
+ * @param size   The number of elements in the array.
+ */
+#define iter_array(type, array, size) {                     \
+  __typeof__(&(array)[0]) _lc_src = &(array)[0];            \
+  const lc_index_t _lc_end = (size);                        \
+  for(lc_index_t _lc_i=0;_lc_i<_lc_end;_lc_i++) {           \
+    type _lc_v = _lc_src[_lc_i];                            \
+    if (!_lc_sink(_lc_v)) break;                            \
+  }                                                         \
+}
+
+/**
+ * @brief Source pushing the elements of a linked structure, up to NULL.
+ *
+ * @param type     The type of the elements (a pointer type).
+ * @param first_e  The first element.
+ * @param next     The lambda function body returning the element
+ *                 following `value`, as in fold_s.
+ *
+ * Usage:
+ * @code
+ *   iter_s(Node*, head, { return value->next; })
+ * @endcode
+ */
+#define iter_s(type, first_e, next) {                       \
+  type value = first_e;                                     \
+  _𝛌_bind(_𝛌_next, type, (), next);                         \
+  for(; value!=NULL; value=_𝛌_next())                       \
+    if (!_lc_sink(value)) break;                            \
+}
+
+/**
+ * @brief Source pushing an endless sequence: first_e, then the value
+ * computed by `next` from the previous one.
+ *
+ * The sequence only ends when a stage or the terminal stops it, with
+ * iter_take or iter_find for instance.
+ *
+ * @param type     The type of the elements.
+ * @param first_e  The first element.
+ * @param next     The lambda function body returning the element
+ *                 following `value`.
+ *
+ * Usage:
+ * @code
+ *   // 1, 2, 4, 8...
+ *   iter_gen(long, 1, { return 2 * value; })
+ * @endcode
+ */
+#define iter_gen(type, first_e, next) {                     \
+  type value = first_e;                                     \
+  _𝛌_bind(_𝛌_next, type, (), next);                         \
+  for(;; value=_𝛌_next())                                   \
+    if (!_lc_sink(value)) break;                            \
+}
+
+/**
+ * @brief Stage transforming each element.
+ *
+ * @param in_type   The type of the elements of the previous stage.
+ * @param out_type  The type of the transformed elements.
+ * @param src       The previous stage (or source).
+ * @param body      The lambda function body transforming `value`, as in map.
+ */
+#define iter_map(in_type, out_type, src, body) {            \
+  int _lc_up(out_type value) { return _lc_sink(value); }    \
+  {                                                         \
+    _𝛌_bind(_𝛌_map, out_type, (in_type value), body);       \
+    int _lc_sink(in_type value) {                           \
+      return _lc_up(_𝛌_map(value));                         \
+    }                                                       \
+    src                                                     \
+  }                                                         \
+}
+
+/**
+ * @brief Stage keeping the elements satisfying a predicate.
+ *
+ * @param type  The type of the elements.
+ * @param src   The previous stage (or source).
+ * @param body  The lambda function body returning non-zero when `value`
+ *              is to be kept, as in filter.
+ */
+#define iter_filter(type, src, body) {                      \
+  int _lc_up(type value) { return _lc_sink(value); }        \
+  {                                                         \
+    _𝛌_bind(_𝛌_pred, int, (type value), body);              \
+    int _lc_sink(type value) {                              \
+      return _𝛌_pred(value) ? _lc_up(value) : 1;            \
+    }                                                       \
+    src                                                     \
+  }                                                         \
+}
+
+/**
+ * @brief Stage keeping the first `count` elements, then stopping the source.
+ *
+ * @param type   The type of the elements.
+ * @param src    The previous stage (or source).
+ * @param count  The number of elements to keep.
+ */
+#define iter_take(type, src, count) {                       \
+  lc_index_t _lc_left = (count);                            \
+  int _lc_up(type value) { return _lc_sink(value); }        \
+  if (_lc_left > 0) {                                       \
+    int _lc_sink(type value) {                              \
+      return _lc_up(value) && --_lc_left > 0;               \
+    }                                                       \
+    src                                                     \
+  }                                                         \
+}
+
+/**
+ * @brief Terminal folding the elements of a pipeline.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements of the pipeline.
+ * @param pipe          The pipeline.
+ * @param body          The lambda function body computing the next
+ *                      accumulator from `acc` and `value`, as in fold.
+ * @param init_acc      The initial value of the accumulator.
+ */
+#define iter_fold(acc_type, element_type, pipe, body, init_acc) ({ \
+  acc_type acc = init_acc;                                  \
+  _𝛌_bind(_𝛌_body, acc_type, (element_type value), body);   \
+  int _lc_sink(element_type value) {                        \
+    acc = _𝛌_body(value);                                   \
+    return 1;                                               \
+  }                                                         \
+  pipe                                                      \
+  ; acc; })
+
+/**
+ * @brief Terminal storing the elements of a pipeline into an array.
+ *
+ * The pipeline is stopped once the array is full. Returns the number
+ * of stored elements.
+ *
+ * @param type       The type of the elements.
+ * @param pipe       The pipeline.
+ * @param out_array  The output array.
+ * @param capacity   The number of elements out_array can hold.
+ */
+#define iter_collect(type, pipe, out_array, capacity) ({    \
+  __typeof__(&(out_array)[0]) _lc_out = &(out_array)[0];    \
+  const lc_index_t _lc_cap = (capacity);                    \
+  lc_index_t _lc_n = 0;                                     \
+  int _lc_sink(type value) {                                \
+    if (_lc_n == _lc_cap) return 0;                         \
+    _lc_out[_lc_n++] = value;                               \
+    return _lc_n < _lc_cap;                                 \
+  }                                                         \
+  pipe                                                      \
+  ; _lc_n; })
+
+/**
+ * @brief Terminal returning the first element of a pipeline satisfying
+ * a predicate, which stops the pipeline.
+ *
+ * @param type       The type of the elements.
+ * @param pipe       The pipeline.
+ * @param body       The lambda function body returning non-zero for the
+ *                   wanted `value`.
+ * @param not_found  The value returned when no element satisfies it.
+ */
+#define iter_find(type, pipe, body, not_found) ({           \
+  type _lc_found = not_found;                               \
+  _𝛌_bind(_𝛌_pred, int, (type value), body);                \
+  int _lc_sink(type value) {                                \
+    if (!_𝛌_pred(value)) return 1;                          \
+    _lc_found = value;                                      \
+    return 0;                                               \
+  }                                                         \
+  pipe                                                      \
+  ; _lc_found; })
+
+#endif
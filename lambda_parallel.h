@@ -0,0 +1,464 @@
+/**
+ * @file lambda_parallel.h
+ * @brief Multithreaded variants of the LambdaCraft constructs.
+ *
+ * This header file provides parallel counterparts of the macros of
+ * lambda.h. The work is split into chunks, processed by the calling
+ * thread and the persistent workers of lambda_pool.h.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_parallel_h
+#define _lambda_parallel_h
+
+#include <stdint.h>
+#include "lambda.h"
+#include "lambda_pool.h"
+
+/** Size in bytes of a cache line, used to place chunk boundaries. */
+#ifndef LAMBDA_CACHE_LINE
+#define LAMBDA_CACHE_LINE 64
+#endif
+
+/** Size in bytes of the chunks handed out by the dynamic schedule. */
+#ifndef LAMBDA_DYNAMIC_GRAIN
+#define LAMBDA_DYNAMIC_GRAIN 4096
+#endif
+
+/** Number of elements between the split points recorded by pfold_s. */
+#ifndef LAMBDA_SPLIT_STRIDE
+#define LAMBDA_SPLIT_STRIDE 1024
+#endif
+
+/** Scheduling modes of pmap. */
+#define LC_STATIC  0
+#define LC_DYNAMIC 1
+
+/**
+ * @brief Run chunk(0) ... chunk(n-1) concurrently.
+ *
+ * The chunks are handed to the thread pool of lambda_pool.h, the calling
+ * thread taking its share. Returns once every chunk is done.
+ */
+static inline void _lc_parallel_run(int n, void (*chunk)(int)) {
+  lc_pool_run(n, chunk);
+}
+
+/**
+ * @brief Move a chunk boundary up to the first element of `base` that
+ * starts on a cache line.
+ *
+ * Two threads writing both sides of a boundary then never share a line
+ * (when the element size divides the line size). Never returns more 
+ * than `size`.
+ */
+static inline lc_index_t _lc_line_align(const void *base, lc_index_t index, size_t elem_size, lc_index_t size) {
+  uintptr_t addr = (uintptr_t)base + index * elem_size;
+  uintptr_t line = (addr + LAMBDA_CACHE_LINE - 1) & ~(uintptr_t)(LAMBDA_CACHE_LINE - 1);
+  index += (line - addr + elem_size - 1) / elem_size;
+  return index < size ? index : size;
+}
+
+/**
+ * @brief Run the nested function `chunk` for each chunk index in [0, n).
+ *
+ * Handing a lambda to another thread needs its address, hence a
+ * trampoline. With LAMBDA_NO_TRAMPOLINE the chunks are therefore run in
+ * order by the calling thread: the chunking, and so the result, stays
+ * the same.
+ */
+#ifdef LAMBDA_NO_TRAMPOLINE
+#define _lc_parallel(n, chunk) ({ for(int _lc_t=0;_lc_t<(n);_lc_t++) chunk(_lc_t); })
+#else
+#define _lc_parallel(n, chunk) _lc_parallel_run(n, chunk)
+#endif
+
+/**
+ * @brief Performs a fold operation on an array using several threads.
+ *
+ * The array is split into `nthreads` contiguous chunks of (almost) equal
+ * size. Each chunk is folded by a thread of the pool from `init_acc`
+ * (`index` still being the position in the whole array),
+ * then the partial accumulators are merged in chunk order with `combine`.
+ * For a given thread count the result is therefore deterministic, even
+ * for non-associative floating point operations.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array on which the fold operation is to be performed.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body which processes each array element,
+ *                      as in fold.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators: the merged one so far (`acc`) and the one
+ *                      of the next chunk (`value`).
+ * @param init_acc      The initial value of each chunk accumulator. It must be
+ *                      an identity for combine (0 for a sum, 1 for a product...).
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   long sum = pfold(long, int, numbers, n,
+ *      { return acc + value; },
+ *      { return acc + value; }, 0, 8);
+ * @endcode
+ */
+#define pfold(acc_type, element_type, in_array, size, body, combine, init_acc, nthreads) ({ \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];               \
+  lc_index_t _lc_size = (size);                                      \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                      \
+  acc_type _lc_partial[_lc_nt];                                      \
+  void _𝛌_chunk(int _lc_t) {                                         \
+    lc_index_t _lc_lo = _lc_size * _lc_t / _lc_nt;                   \
+    lc_index_t _lc_hi = _lc_size * (_lc_t + 1) / _lc_nt;             \
+    _lc_partial[_lc_t] = _fold_range(acc_type, element_type, _lc_in, \
+                          _lc_lo, _lc_hi, body, init_acc);           \
+  }                                                                  \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                    \
+  fold(acc_type, acc_type, (_lc_partial + 1), _lc_nt - 1, combine,   \
+       _lc_partial[0]); })
+
+/**
+ * @brief Performs a map_fold operation on an array using several threads.
+ *
+ * As for pfold, the array is split into `nthreads` contiguous chunks,
+ * each chunk is map_folded by a thread of the pool from `init_acc`,
+ * and the partial accumulators are merged in chunk order with `combine`.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param map_type      The type of the transformed elements.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param map_body      The lambda function body transforming each element,
+ *                      as in map_fold.
+ * @param fold_body     The lambda function body accumulating each transformed
+ *                      element, as in map_fold.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of each chunk accumulator. It must be
+ *                      an identity for combine.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   double norm2 = pmap_fold(double, double, double, v, n,
+ *      { return value * value; },
+ *      { return acc + value; },
+ *      { return acc + value; }, 0.0, 8);
+ * @endcode
+ */
+#define pmap_fold(acc_type, element_type, map_type, in_array, size, map_body, fold_body, combine, init_acc, nthreads) ({ \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];               \
+  lc_index_t _lc_size = (size);                                      \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                      \
+  acc_type _lc_partial[_lc_nt];                                      \
+  void _𝛌_chunk(int _lc_t) {                                         \
+    lc_index_t _lc_lo = _lc_size * _lc_t / _lc_nt;                   \
+    lc_index_t _lc_hi = _lc_size * (_lc_t + 1) / _lc_nt;             \
+    _lc_partial[_lc_t] = _map_fold_range(acc_type, element_type,     \
+                          map_type, _lc_in, _lc_lo, _lc_hi,          \
+                          map_body, fold_body, init_acc);            \
+  }                                                                  \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                    \
+  fold(acc_type, acc_type, (_lc_partial + 1), _lc_nt - 1, combine,   \
+       _lc_partial[0]); })
+
+/**
+ * @brief Performs a fold operation on a linked structure using several
+ * threads, from split points recorded beforehand.
+ *
+ * The split points, as recorded by split_s (or any element reachable
+ * from the previous one through `next`, in order), cut the structure
+ * into segments, each ending just before the next split point and the
+ * last one at NULL. The segments are spread into `nthreads` contiguous
+ * chunks; each chunk is folded by a thread of the pool from `init_acc`,
+ * then the partial accumulators are merged in order with `combine`, as
+ * in pfold.
+ *
+ * The split points stay valid while the links do not change, so a
+ * structure folded many times is only walked serially once.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements (a pointer type).
+ * @param splits        The array of split points, splits[0] being the
+ *                      first element of the structure.
+ * @param nsplits       The number of split points.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body computing the next
+ *                      accumulator from `acc` and `value`, as in fold_s.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of each chunk accumulator. It must be
+ *                      an identity for combine.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   node_vec splits = LC_VEC_INIT;
+ *   split_s(Node *, head, { return value->next; }, 1024, &splits);
+ *   for (int pass = 0; pass < passes; pass++)
+ *     total += pfold_s_splits(long, Node *, splits.data, splits.size,
+ *        { return value->next; },
+ *        { return acc + value->data; },
+ *        { return acc + value; }, 0, 8);
+ *   vec_free(&splits);
+ * @endcode
+ */
+#define pfold_s_splits(acc_type, element_type, splits, nsplits, next, body, combine, init_acc, nthreads) ({ \
+  element_type const *_lc_splits = (splits);                         \
+  lc_index_t _lc_nsplits = (nsplits);                                \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                      \
+  acc_type _lc_partial[_lc_nt];                                      \
+  void _𝛌_chunk(int _lc_t) {                                         \
+    lc_index_t _lc_lo = _lc_nsplits * _lc_t / _lc_nt;                \
+    lc_index_t _lc_hi = _lc_nsplits * (_lc_t + 1) / _lc_nt;          \
+    _lc_partial[_lc_t] = _lc_lo == _lc_hi ? (acc_type)(init_acc) :   \
+      _fold_s_range(acc_type, element_type, _lc_splits[_lc_lo],      \
+                    _lc_hi < _lc_nsplits ? _lc_splits[_lc_hi] : NULL,\
+                    next, body, init_acc);                           \
+  }                                                                  \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                    \
+  fold(acc_type, acc_type, (_lc_partial + 1), _lc_nt - 1, combine,   \
+       _lc_partial[0]); })
+
+/**
+ * @brief Performs a fold operation on a linked structure using several
+ * threads.
+ *
+ * A first serial pass records every LAMBDA_SPLIT_STRIDE-th element with
+ * split_s, then pfold_s_splits folds the segments on several threads.
+ * The first pass only follows the links, so a body heavier than a link
+ * lookup gains from the threads; to fold the same structure many
+ * times, record the split points once and call pfold_s_splits.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param body          The lambda function body, as in fold_s.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of each chunk accumulator. It must be
+ *                      an identity for combine.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   long total = pfold_s(long, Node *, head,
+ *      { return value->next; },
+ *      { return acc + score(value); },
+ *      { return acc + value; }, 0, 8);
+ * @endcode
+ */
+#define pfold_s(acc_type, element_type, first_e, next, body, combine, init_acc, nthreads) ({ \
+  vec_t(element_type) _lc_sp = LC_VEC_INIT;                          \
+  split_s(element_type, first_e, next, LAMBDA_SPLIT_STRIDE, &_lc_sp);\
+  acc_type _lc_r = pfold_s_splits(acc_type, element_type, _lc_sp.data,\
+    _lc_sp.size, next, body, combine, init_acc, nthreads);           \
+  vec_free(&_lc_sp);                                                 \
+  _lc_r; })
+
+/**
+ * @brief Performs a fold operation on a linked structure with skip
+ * links using several threads.
+ *
+ * The split points are the elements reached from the first one through
+ * `skip` (a skip list level, a pointer to the next block...), which
+ * walks the structure much faster than `next`. Each split point must be
+ * reachable from the previous one through `next`. The segments between
+ * them are then folded as in pfold_s_splits.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements (a pointer type).
+ * @param first_e       The first element of the structure.
+ * @param next          The lambda function body returning the element
+ *                      following `value`, as in fold_s.
+ * @param skip          The lambda function body returning an element
+ *                      further than `value`, or NULL past the last one.
+ * @param body          The lambda function body, as in fold_s.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of each chunk accumulator. It must be
+ *                      an identity for combine.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   long total = pfold_s_skip(long, Node *, head,
+ *      { return value->next; },
+ *      { return value->skip; },
+ *      { return acc + value->data; },
+ *      { return acc + value; }, 0, 8);
+ * @endcode
+ */
+#define pfold_s_skip(acc_type, element_type, first_e, next, skip, body, combine, init_acc, nthreads) ({ \
+  vec_t(element_type) _lc_sp = LC_VEC_INIT;                          \
+  split_s(element_type, first_e, skip, 1, &_lc_sp);                  \
+  acc_type _lc_r = pfold_s_splits(acc_type, element_type, _lc_sp.data,\
+    _lc_sp.size, next, body, combine, init_acc, nthreads);           \
+  vec_free(&_lc_sp);                                                 \
+  _lc_r; })
+
+/**
+ * @brief Performs an inclusive scan on an array using several threads.
+ *
+ * Two passes over `nthreads` contiguous chunks: each chunk but the last
+ * is first folded from `init_acc`, the partial accumulators are then
+ * scanned with `combine` into the offset of every chunk, and finally
+ * each chunk is scanned from its offset. The input is read twice and
+ * the output written once.
+ *
+ * The body must be compatible with combine: scanning a chunk from an
+ * offset gives the same accumulators as combining the offset with the
+ * scan of the chunk from `init_acc` (true of sums, products, min, max...).
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body, as in scan.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of the accumulator. It must be
+ *                      an identity for combine.
+ * @param out_array     The output array of `size` accumulators.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   long totals[n];
+ *   pscan(long, int, numbers, n,
+ *      { return acc + value; },
+ *      { return acc + value; }, 0, totals, 8);
+ * @endcode
+ */
+#define pscan(acc_type, element_type, in_array, size, body, combine, init_acc, out_array, nthreads) \
+  _pscan(acc_type, element_type, in_array, size, body, combine, init_acc, out_array, nthreads, 1)
+
+/**
+ * @brief Performs an exclusive scan on an array using several threads.
+ *
+ * The exclusive counterpart of pscan: out_array[i] receives the
+ * accumulator before the element i is folded.
+ *
+ * @param acc_type      The type of the accumulator variable.
+ * @param element_type  The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          The lambda function body, as in scan.
+ * @param combine       The lambda function body which merges two partial
+ *                      accumulators, as in pfold.
+ * @param init_acc      The initial value of the accumulator. It must be
+ *                      an identity for combine.
+ * @param out_array     The output array of `size` accumulators.
+ * @param nthreads      The number of chunks, hence of threads at most.
+ */
+#define pexscan(acc_type, element_type, in_array, size, body, combine, init_acc, out_array, nthreads) \
+  _pscan(acc_type, element_type, in_array, size, body, combine, init_acc, out_array, nthreads, 0)
+
+#define _pscan(acc_type, element_type, in_array, size, body, combine, init_acc, out_array, nthreads, inclusive) ({ \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];               \
+  __typeof__(&(out_array)[0]) _lc_out = &(out_array)[0];            \
+  lc_index_t _lc_size = (size);                                      \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                      \
+  /* _lc_offset[t]: accumulator at the start of chunk t */           \
+  acc_type _lc_offset[_lc_nt];                                       \
+  void _𝛌_reduce(int _lc_t) {                                        \
+    lc_index_t _lc_lo = _lc_size * _lc_t / _lc_nt;                   \
+    lc_index_t _lc_hi = _lc_size * (_lc_t + 1) / _lc_nt;             \
+    _lc_offset[_lc_t + 1] = _fold_range(acc_type, element_type,      \
+                             _lc_in, _lc_lo, _lc_hi, body, init_acc);\
+  }                                                                  \
+  if (_lc_nt > 1) _lc_parallel(_lc_nt - 1, _𝛌_reduce);               \
+  scan(acc_type, acc_type, (_lc_offset + 1), _lc_nt - 1, combine,    \
+       init_acc, (_lc_offset + 1));                                  \
+  _lc_offset[0] = init_acc;                                          \
+  void _𝛌_chunk(int _lc_t) {                                         \
+    lc_index_t _lc_lo = _lc_size * _lc_t / _lc_nt;                   \
+    lc_index_t _lc_hi = _lc_size * (_lc_t + 1) / _lc_nt;             \
+    _lc_offset[_lc_t] = _scan_range(acc_type, element_type, _lc_in,  \
+                         _lc_lo, _lc_hi, body, _lc_offset[_lc_t],    \
+                         _lc_out, inclusive);                        \
+  }                                                                  \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                    \
+  _lc_offset[_lc_nt - 1]; })
+
+/**
+ * @brief Performs a map operation on an array using several threads.
+ *
+ * The index range is cut into chunks whose boundaries are moved to 
+ * cache line starts of `out_array`, so that no two threads write the 
+ * same line. Two schedules are available:
+ * - LC_STATIC: one chunk of (almost) equal size per thread, for bodies
+ *   of uniform cost;
+ * - LC_DYNAMIC: chunks of LAMBDA_DYNAMIC_GRAIN bytes handed out by an 
+ *   atomic counter to whichever thread is free, for skewed bodies.
+ *
+ * @param type      The type of the elements in the array.
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ * @param body      The lambda function body processing `value`, as in map.
+ * @param out_array The output array.
+ * @param nthreads  The number of threads.
+ * @param schedule  LC_STATIC or LC_DYNAMIC.
+ *
+ * Usage:
+ * @code
+ *   pmap(double, in, n, { return sqrt(value); }, out, 8, LC_STATIC);
+ * @endcode
+ */
+#define pmap(type, in_array, size, body, out_array, nthreads, schedule) ({ \
+  __typeof__(&(in_array)[0]) _lc_in = &(in_array)[0];                \
+  __typeof__(&(out_array)[0]) _lc_out = &(out_array)[0];             \
+  lc_index_t _lc_size = (size);                                       \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                       \
+  int _lc_dynamic = (schedule) == LC_DYNAMIC;                         \
+  lc_index_t _lc_grain = LAMBDA_DYNAMIC_GRAIN / sizeof(type) ?        \
+                         LAMBDA_DYNAMIC_GRAIN / sizeof(type) : 1;     \
+  lc_index_t _lc_nchunks = _lc_dynamic ?                              \
+    (_lc_size + _lc_grain - 1) / _lc_grain : (lc_index_t)_lc_nt;      \
+  lc_index_t _lc_next = 0;                                            \
+  lc_index_t _𝛌_bound(lc_index_t _lc_k) {                             \
+    if (_lc_k == 0) return 0;                                         \
+    if (_lc_k >= _lc_nchunks) return _lc_size;                        \
+    return _lc_line_align(_lc_out, _lc_dynamic ? _lc_k * _lc_grain    \
+                          : _lc_size * _lc_k / _lc_nchunks,           \
+                          sizeof(type), _lc_size);                    \
+  }                                                                   \
+  lc_index_t _𝛌_take(int _lc_t) {                                     \
+    return _lc_dynamic ? __atomic_fetch_add(&_lc_next, 1, __ATOMIC_RELAXED)\
+                       : (lc_index_t)_lc_t;                           \
+  }                                                                   \
+  void _𝛌_chunk(int _lc_t) {                                          \
+    for (lc_index_t _lc_k = _𝛌_take(_lc_t); _lc_k < _lc_nchunks;      \
+         _lc_k = _lc_dynamic ? _𝛌_take(_lc_t) : _lc_nchunks) {        \
+      _map_range(type, _lc_in, _𝛌_bound(_lc_k), _𝛌_bound(_lc_k + 1),  \
+                 body, _lc_out);                                      \
+    }                                                                 \
+  }                                                                   \
+  _lc_parallel(_lc_nt, _𝛌_chunk);                                     \
+  ; })
+
+#endif
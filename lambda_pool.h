@@ -0,0 +1,347 @@
+/**
+ * @file lambda_pool.h
+ * @brief Process-wide persistent thread pool running the parallel constructs.
+ *
+ * This header file provides the pool behind lambda_parallel.h. Its
+ * worker threads are started once, on the first parallel call, each one
+ * pinned to a core the process may run on (its affinity mask, as set by
+ * taskset or a container), and then wait for jobs for the rest of the
+ * process.
+ * A dispatch therefore costs a few atomic operations, and a futex wake
+ * when workers went to sleep, instead of a pthread_create and a
+ * pthread_join per chunk.
+ *
+ * A job is a chunk function and a chunk count, living on the stack of
+ * the thread that submits it. The submitting thread pushes one ticket
+ * per helper wanted into a lock-free bounded queue, then claims chunks
+ * itself along with the workers that pop the tickets. It returns once
+ * every ticket has been released, helping with other queued jobs while
+ * it waits, so a chunk may itself run a parallel construct.
+ *
+ * Idle workers (and waiting submitters) spin for LAMBDA_POOL_SPIN rounds
+ * before sleeping on a futex (a plain yield outside Linux). While they
+ * spin, workers also steal the tasks spawned through lambda_task.h.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_pool_h
+#define _lambda_pool_h
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/** Number of worker threads; 0 for one per usable core but the first. */
+#ifndef LAMBDA_POOL_THREADS
+#define LAMBDA_POOL_THREADS 0
+#endif
+
+/** Capacity of the submission queue, in tickets (a power of two). */
+#ifndef LAMBDA_POOL_QUEUE
+#define LAMBDA_POOL_QUEUE 256
+#endif
+
+/** Rounds of polling before a waiting thread sleeps. */
+#ifndef LAMBDA_POOL_SPIN
+#define LAMBDA_POOL_SPIN 4096
+#endif
+
+/** Pin each worker to a core (Linux only). */
+#ifndef LAMBDA_POOL_PIN
+#define LAMBDA_POOL_PIN 1
+#endif
+
+/*
+ * The parallel constructs and spawn hand a nested function to the pool,
+ * which needs its address, hence a trampoline. With LAMBDA_NO_TRAMPOLINE
+ * they run in the calling thread; lc_pool_run, which takes a plain
+ * function, still uses the workers.
+ */
+#if defined(LAMBDA_NO_TRAMPOLINE) && !defined(LAMBDA_NX_SERIAL)
+#warning "LAMBDA_NO_TRAMPOLINE: the parallel constructs and spawn run in the calling thread (define LAMBDA_NX_SERIAL to acknowledge)"
+#endif
+
+/* Set of CPUs, in the layout of the sched_setaffinity system call. */
+typedef unsigned long _lc_cpu_mask[1024 / (8 * sizeof(unsigned long))];
+
+#define _LC_CPU_BITS (8 * sizeof(unsigned long))
+
+/* Set in the state of a job while its submitter sleeps. */
+#define _LC_POOL_SLEEPING 0x40000000
+
+typedef struct {
+  void (*chunk)(int);
+  int n;
+  int next;   /* next chunk to claim */
+  int state;  /* tickets not released, plus _LC_POOL_SLEEPING */
+} _lc_job;
+
+typedef struct {
+  size_t seq;
+  _lc_job *job;
+} _lc_pool_cell;
+
+/*
+ * The pool is a weak symbol: every translation unit including this
+ * header shares the same one.
+ */
+typedef struct {
+  pthread_once_t once;
+  int workers;
+  int signal;    /* bumped on each submission, futex of idle workers */
+  int sleepers;
+  int (*steal)(void);  /* other work for idle workers (lambda_task.h) */
+  int ncpus;           /* CPUs in cpus */
+  _lc_cpu_mask cpus;   /* CPUs the process may run on, when known */
+  char _pad0[64];
+  size_t enqueue;
+  char _pad1[64];
+  size_t dequeue;
+  char _pad2[64];
+  _lc_pool_cell ring[LAMBDA_POOL_QUEUE];
+} _lc_pool_t;
+
+__attribute__((weak)) _lc_pool_t _lc_pool = { .once = PTHREAD_ONCE_INIT };
+
+static inline void _lc_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static inline void _lc_futex_wait(int *addr, int value) {
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+  (void)addr; (void)value;
+  sched_yield();
+#endif
+}
+
+static inline void _lc_futex_wake(int *addr, int count) {
+#ifdef __linux__
+  syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+  (void)addr; (void)count;
+#endif
+}
+
+/* Bounded multi-producer multi-consumer queue (D. Vyukov): 0 when full. */
+static inline int _lc_pool_push(_lc_job *job) {
+  size_t pos = __atomic_load_n(&_lc_pool.enqueue, __ATOMIC_RELAXED);
+  for (;;) {
+    _lc_pool_cell *cell = &_lc_pool.ring[pos & (LAMBDA_POOL_QUEUE - 1)];
+    size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&_lc_pool.enqueue, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        cell->job = job;
+        __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+        return 1;
+      }
+    } else if ((ptrdiff_t)(seq - pos) < 0) {
+      return 0;
+    } else {
+      pos = __atomic_load_n(&_lc_pool.enqueue, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/* NULL when empty. */
+static inline _lc_job *_lc_pool_pop(void) {
+  size_t pos = __atomic_load_n(&_lc_pool.dequeue, __ATOMIC_RELAXED);
+  for (;;) {
+    _lc_pool_cell *cell = &_lc_pool.ring[pos & (LAMBDA_POOL_QUEUE - 1)];
+    size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos + 1) {
+      if (__atomic_compare_exchange_n(&_lc_pool.dequeue, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        _lc_job *job = cell->job;
+        __atomic_store_n(&cell->seq, pos + LAMBDA_POOL_QUEUE, __ATOMIC_RELEASE);
+        return job;
+      }
+    } else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&_lc_pool.dequeue, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/* Run the chunks of job not claimed yet. */
+static inline void _lc_job_work(_lc_job *job) {
+  int t;
+  while ((t = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->n)
+    job->chunk(t);
+}
+
+/* Work on a popped ticket, then release it, waking the submitter if asleep. */
+static inline void _lc_job_ticket(_lc_job *job) {
+  _lc_job_work(job);
+  if (__atomic_fetch_sub(&job->state, 1, __ATOMIC_ACQ_REL) == (_LC_POOL_SLEEPING | 1))
+    _lc_futex_wake(&job->state, 1);
+}
+
+/*
+ * Number of CPUs the calling thread may run on, their set being stored
+ * in the pool. Falls back to the online CPUs, with an empty set, when the
+ * affinity mask cannot be read.
+ */
+static inline long _lc_pool_cpus(void) {
+#ifdef __linux__
+  long bytes = syscall(SYS_sched_getaffinity, 0, sizeof(_lc_pool.cpus), _lc_pool.cpus);
+  if (bytes > 0) {
+    long n = 0;
+    for (size_t i = 0; i < (size_t)bytes / sizeof(unsigned long); i++)
+      n += __builtin_popcountl(_lc_pool.cpus[i]);
+    if (n > 0) return _lc_pool.ncpus = n;
+  }
+  memset(_lc_pool.cpus, 0, sizeof(_lc_pool.cpus));
+#endif
+  return sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static inline void *_lc_pool_worker(void *arg) {
+#if LAMBDA_POOL_PIN && defined(__linux__)
+  /* Worker w runs on the (w + 1)-th CPU of the set, the first one being
+   * left to the submitting thread. */
+  if (_lc_pool.ncpus > 0) {
+    long skip = ((long)(ptrdiff_t)arg + 1) % _lc_pool.ncpus;
+    for (size_t cpu = 0; cpu < 8 * sizeof(_lc_pool.cpus); cpu++) {
+      unsigned long bit = 1UL << (cpu % _LC_CPU_BITS);
+      if (!(_lc_pool.cpus[cpu / _LC_CPU_BITS] & bit) || skip-- > 0) continue;
+      _lc_cpu_mask mask = {0};
+      mask[cpu / _LC_CPU_BITS] = bit;
+      syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask);
+      break;
+    }
+  }
+#else
+  (void)arg;
+#endif
+  for (;;) {
+    _lc_job *job = NULL;
+    int (*steal)(void) = __atomic_load_n(&_lc_pool.steal, __ATOMIC_ACQUIRE);
+    for (int spin = 0; spin < LAMBDA_POOL_SPIN && !(job = _lc_pool_pop()); spin++) {
+      if (steal && steal()) spin = 0;
+      else _lc_pause();
+    }
+    if (!job) {
+      int signal = __atomic_load_n(&_lc_pool.signal, __ATOMIC_SEQ_CST);
+      __atomic_fetch_add(&_lc_pool.sleepers, 1, __ATOMIC_SEQ_CST);
+      if (!(job = _lc_pool_pop()) && !(steal && steal()))
+        _lc_futex_wait(&_lc_pool.signal, signal);
+      __atomic_fetch_sub(&_lc_pool.sleepers, 1, __ATOMIC_SEQ_CST);
+    }
+    if (job) _lc_job_ticket(job);
+  }
+  return NULL;
+}
+
+static inline void _lc_pool_start(void) {
+  for (size_t i = 0; i < LAMBDA_POOL_QUEUE; i++)
+    _lc_pool.ring[i].seq = i;
+  long n = LAMBDA_POOL_THREADS;
+  long cpus = _lc_pool_cpus();
+  if (n <= 0) n = cpus - 1;
+  for (long w = 0; w < n; w++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, _lc_pool_worker, (void *)(ptrdiff_t)w) != 0)
+      break;
+    pthread_detach(thread);
+    _lc_pool.workers++;
+  }
+}
+
+/* Wake an idle worker, if any, after new work was made available. */
+static inline void _lc_pool_notify(int count) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&_lc_pool.sleepers, __ATOMIC_SEQ_CST)) {
+    __atomic_fetch_add(&_lc_pool.signal, 1, __ATOMIC_SEQ_CST);
+    _lc_futex_wake(&_lc_pool.signal, count);
+  }
+}
+
+/**
+ * @brief Number of worker threads of the pool, starting it if needed.
+ *
+ * The calling thread comes in addition: a job of lc_pool_size() + 1
+ * chunks keeps every core busy.
+ */
+static inline int lc_pool_size(void) {
+  pthread_once(&_lc_pool.once, _lc_pool_start);
+  return _lc_pool.workers;
+}
+
+/**
+ * @brief Run chunk(0) ... chunk(n-1) on the pool and the calling thread.
+ *
+ * Chunks are claimed one at a time by the calling thread and the workers
+ * that take the job, so any chunk may run on any of them. When the pool
+ * has no worker, or its queue is full, the calling thread runs the chunks
+ * left alone. Returns once every chunk is done.
+ *
+ * @param n      The number of chunks.
+ * @param chunk  The function running one chunk, given its index.
+ *
+ * Usage:
+ * @code
+ *   void square(int t) { out[t] = in[t] * in[t]; }
+ *   lc_pool_run(8, square);
+ * @endcode
+ */
+static inline void lc_pool_run(int n, void (*chunk)(int)) {
+  _lc_job job = { chunk, n, 0, 0 };
+  int helpers = n - 1 < lc_pool_size() ? n - 1 : lc_pool_size();
+  int pushed = 0;
+  __atomic_store_n(&job.state, helpers, __ATOMIC_RELAXED);
+  while (pushed < helpers && _lc_pool_push(&job)) pushed++;
+  if (pushed < helpers)
+    __atomic_fetch_sub(&job.state, helpers - pushed, __ATOMIC_RELAXED);
+  if (pushed) _lc_pool_notify(pushed);
+  _lc_job_work(&job);
+  /* Wait for the tickets, running queued jobs (our own leftover tickets
+     included) meanwhile. */
+  for (int spin = 0;; spin++) {
+    int state = __atomic_load_n(&job.state, __ATOMIC_ACQUIRE);
+    if (state == 0) break;
+    _lc_job *other = _lc_pool_pop();
+    if (other) {
+      _lc_job_ticket(other);
+      spin = 0;
+    } else if (spin < LAMBDA_POOL_SPIN) {
+      _lc_pause();
+    } else if (__atomic_compare_exchange_n(&job.state, &state, state | _LC_POOL_SLEEPING,
+                                           0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      _lc_futex_wait(&job.state, state | _LC_POOL_SLEEPING);
+      __atomic_fetch_and(&job.state, ~_LC_POOL_SLEEPING, __ATOMIC_ACQ_REL);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,507 @@
+/**
+ * @file lambda_simd.h
+ * @brief Vectorized folds for the built-in arithmetic reductions.
+ *
+ * This header file provides sum, min, max and dot-product folds over
+ * arrays of double, float and int. They are dispatched on the element
+ * type with _Generic, and run vector kernels written with the GCC vector
+ * extensions. Each kernel is compiled twice, for the baseline instruction
+ * set and for AVX2, the AVX2 one being selected at run time when the CPU
+ * supports it: no special hardware flag is needed at compile time.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_simd_h
+#define _lambda_simd_h
+
+#include <limits.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "lambda.h"
+
+/*
+ * Vector types, 32 bytes wide, loaded from arrays of their element type
+ * without alignment requirement:
+ * - _lc_v<T>: arithmetic (unsigned for int, so that sums wrap around);
+ * - _lc_c<T>: comparisons;
+ * - _lc_m<T>: masks resulting from the comparisons.
+ */
+#define _LC_VECTOR(name, T) \
+  typedef T name __attribute__((vector_size(32), aligned(sizeof(T)), may_alias))
+_LC_VECTOR(_lc_vdouble, double);
+_LC_VECTOR(_lc_cdouble, double);
+_LC_VECTOR(_lc_mdouble, long long);
+_LC_VECTOR(_lc_vfloat, float);
+_LC_VECTOR(_lc_cfloat, float);
+_LC_VECTOR(_lc_mfloat, int);
+_LC_VECTOR(_lc_vint, unsigned);
+_LC_VECTOR(_lc_cint, int);
+_LC_VECTOR(_lc_mint, int);
+
+/* Keep, lane by lane, x when `x op y` holds and y otherwise. */
+#define _LC_VPICK(T, x, op, y) ({                                         \
+  _lc_m##T _k = (x) op (y);                                               \
+  (_lc_c##T)(((_lc_m##T)(x) & _k) | ((_lc_m##T)(y) & ~_k)); })
+
+/*
+ * Reduction kernels for element type T. Four vector accumulators hide
+ * the latency of the vector operations; the elements left over by the
+ * vector loop are processed by scalar code.
+ */
+#define _LC_SIMD_KERNELS(T, isa, attr)                                    \
+attr static inline T _lc_sum_##T##_##isa(const T *a, lc_index_t n) {      \
+  const lc_index_t l = sizeof(_lc_v##T) / sizeof(T);                      \
+  _lc_v##T s0 = {0}, s1 = {0}, s2 = {0}, s3 = {0};                        \
+  lc_index_t i = 0;                                                       \
+  for (; i + 4 * l <= n; i += 4 * l) {                                    \
+    s0 += *(const _lc_v##T *)(a + i);                                     \
+    s1 += *(const _lc_v##T *)(a + i + l);                                 \
+    s2 += *(const _lc_v##T *)(a + i + 2 * l);                             \
+    s3 += *(const _lc_v##T *)(a + i + 3 * l);                             \
+  }                                                                       \
+  s0 = (s0 + s1) + (s2 + s3);                                             \
+  __typeof__(s0[0]) r = 0;                                                \
+  for (lc_index_t k = 0; k < l; k++) r += s0[k];                          \
+  for (; i < n; i++) r += a[i];                                           \
+  return r;                                                               \
+}                                                                         \
+attr static inline T _lc_dot_##T##_##isa(const T *a, const T *b, lc_index_t n) {\
+  const lc_index_t l = sizeof(_lc_v##T) / sizeof(T);                      \
+  _lc_v##T s0 = {0}, s1 = {0}, s2 = {0}, s3 = {0};                        \
+  lc_index_t i = 0;                                                       \
+  for (; i + 4 * l <= n; i += 4 * l) {                                    \
+    s0 += *(const _lc_v##T *)(a + i) * *(const _lc_v##T *)(b + i);        \
+    s1 += *(const _lc_v##T *)(a + i + l) * *(const _lc_v##T *)(b + i + l);\
+    s2 += *(const _lc_v##T *)(a + i + 2 * l)                              \
+        * *(const _lc_v##T *)(b + i + 2 * l);                             \
+    s3 += *(const _lc_v##T *)(a + i + 3 * l)                              \
+        * *(const _lc_v##T *)(b + i + 3 * l);                             \
+  }                                                                       \
+  s0 = (s0 + s1) + (s2 + s3);                                             \
+  __typeof__(s0[0]) r = 0;                                                \
+  for (lc_index_t k = 0; k < l; k++) r += s0[k];                          \
+  for (; i < n; i++) r += (__typeof__(r))a[i] * b[i];                     \
+  return r;                                                               \
+}                                                                         \
+_LC_SIMD_PICK_KERNEL(T, min, <, isa, attr)                                \
+_LC_SIMD_PICK_KERNEL(T, max, >, isa, attr)
+
+/* min and max kernels: the first element seeds every lane. */
+#define _LC_SIMD_PICK_KERNEL(T, name, op, isa, attr)                      \
+attr static inline T _lc_##name##_##T##_##isa(const T *a, lc_index_t n, T empty) {\
+  const lc_index_t l = sizeof(_lc_c##T) / sizeof(T);                      \
+  if (n == 0) return empty;                                               \
+  _lc_c##T m0 = (_lc_c##T){0} + a[0], m1 = m0, m2 = m0, m3 = m0;          \
+  lc_index_t i = 0;                                                       \
+  for (; i + 4 * l <= n; i += 4 * l) {                                    \
+    m0 = _LC_VPICK(T, *(const _lc_c##T *)(a + i), op, m0);                \
+    m1 = _LC_VPICK(T, *(const _lc_c##T *)(a + i + l), op, m1);            \
+    m2 = _LC_VPICK(T, *(const _lc_c##T *)(a + i + 2 * l), op, m2);        \
+    m3 = _LC_VPICK(T, *(const _lc_c##T *)(a + i + 3 * l), op, m3);        \
+  }                                                                       \
+  m0 = _LC_VPICK(T, _LC_VPICK(T, m0, op, m1), op, _LC_VPICK(T, m2, op, m3));\
+  T r = m0[0];                                                            \
+  for (lc_index_t k = 1; k < l; k++) r = m0[k] op r ? m0[k] : r;          \
+  for (; i < n; i++) r = a[i] op r ? a[i] : r;                            \
+  return r;                                                               \
+}
+
+#define _LC_SIMD_ALL_KERNELS(isa, attr) \
+  _LC_SIMD_KERNELS(double, isa, attr)   \
+  _LC_SIMD_KERNELS(float, isa, attr)    \
+  _LC_SIMD_KERNELS(int, isa, attr)
+
+_LC_SIMD_ALL_KERNELS(base, )
+
+#if defined(__x86_64__) || defined(__i386__)
+_LC_SIMD_ALL_KERNELS(avx2, __attribute__((target("avx2,fma"))))
+#define _LC_SIMD_CALL(kernel, ...)                                        \
+  (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")        \
+   ? kernel##_avx2(__VA_ARGS__) : kernel##_base(__VA_ARGS__))
+#else
+#define _LC_SIMD_CALL(kernel, ...) kernel##_base(__VA_ARGS__)
+#endif
+
+/* Entry points, selected by the element type. */
+#define _LC_SIMD_ENTRIES(T, min_empty, max_empty)                         \
+static inline T _lc_sum_##T(const T *a, lc_index_t n) {                   \
+  return _LC_SIMD_CALL(_lc_sum_##T, a, n);                                \
+}                                                                         \
+static inline T _lc_dot_##T(const T *a, const T *b, lc_index_t n) {       \
+  return _LC_SIMD_CALL(_lc_dot_##T, a, b, n);                             \
+}                                                                         \
+static inline T _lc_min_##T(const T *a, lc_index_t n) {                   \
+  return _LC_SIMD_CALL(_lc_min_##T, a, n, min_empty);                     \
+}                                                                         \
+static inline T _lc_max_##T(const T *a, lc_index_t n) {                   \
+  return _LC_SIMD_CALL(_lc_max_##T, a, n, max_empty);                     \
+}
+
+_LC_SIMD_ENTRIES(double, HUGE_VAL, -HUGE_VAL)
+_LC_SIMD_ENTRIES(float, HUGE_VALF, -HUGE_VALF)
+_LC_SIMD_ENTRIES(int, INT_MAX, INT_MIN)
+
+/*
+ * Kernels of the operator tags of fold (LC_ADD...), for an accumulator
+ * of the element type: _lc_fold_<op>_<type>(array, size, init). Integer
+ * sums, products and xors are computed on unsigned integers, at least as
+ * wide as int, so that they wrap around. The loops keep four
+ * accumulators, the first one starting from init and the others from
+ * the identity of the operator (init itself for min and max).
+ */
+#define _LC_LOOP_KERNEL(T, S, U, op, identity)                            \
+static inline T _lc_fold_##op##_##S(const T *a, lc_index_t n, T init) {   \
+  U r0 = (U)init, r1 = (U)(identity), r2 = r1, r3 = r1;                   \
+  lc_index_t i = 0;                                                       \
+  for (; i + 4 <= n; i += 4) {                                            \
+    r0 = _LC_OP_##op(r0, (U)a[i]);                                        \
+    r1 = _LC_OP_##op(r1, (U)a[i + 1]);                                    \
+    r2 = _LC_OP_##op(r2, (U)a[i + 2]);                                    \
+    r3 = _LC_OP_##op(r3, (U)a[i + 3]);                                    \
+  }                                                                       \
+  for (; i < n; i++) r0 = _LC_OP_##op(r0, (U)a[i]);                       \
+  return (T)_LC_OP_##op(_LC_OP_##op(r0, r1), _LC_OP_##op(r2, r3));        \
+}
+
+#define _LC_INT_KERNELS(T, S, U)                                          \
+  _LC_LOOP_KERNEL(T, S, U, add, 0)                                        \
+  _LC_LOOP_KERNEL(T, S, U, mul, 1)                                        \
+  _LC_LOOP_KERNEL(T, S, U, xor, 0)                                        \
+  _LC_LOOP_KERNEL(T, S, T, min, init)                                     \
+  _LC_LOOP_KERNEL(T, S, T, max, init)
+
+_LC_INT_KERNELS(char, char, unsigned)
+_LC_INT_KERNELS(signed char, schar, unsigned)
+_LC_INT_KERNELS(unsigned char, uchar, unsigned)
+_LC_INT_KERNELS(short, short, unsigned)
+_LC_INT_KERNELS(unsigned short, ushort, unsigned)
+_LC_LOOP_KERNEL(int, int, unsigned, mul, 1)
+_LC_LOOP_KERNEL(int, int, unsigned, xor, 0)
+_LC_INT_KERNELS(unsigned, uint, unsigned)
+_LC_INT_KERNELS(long, long, unsigned long)
+_LC_INT_KERNELS(unsigned long, ulong, unsigned long)
+_LC_INT_KERNELS(long long, llong, unsigned long long)
+_LC_INT_KERNELS(unsigned long long, ullong, unsigned long long)
+_LC_LOOP_KERNEL(float, float, float, mul, 1)
+_LC_LOOP_KERNEL(double, double, double, mul, 1)
+
+/* Sums, minimums and maximums of int, float and double use the vector kernels. */
+#define _LC_VECTOR_OP_KERNELS(T)                                          \
+static inline T _lc_fold_add_##T(const T *a, lc_index_t n, T init) {      \
+  return _LC_OP_add(init, _lc_sum_##T(a, n));                             \
+}                                                                         \
+static inline T _lc_fold_min_##T(const T *a, lc_index_t n, T init) {      \
+  return n ? _LC_OP_min(init, _lc_min_##T(a, n)) : init;                  \
+}                                                                         \
+static inline T _lc_fold_max_##T(const T *a, lc_index_t n, T init) {      \
+  return n ? _LC_OP_max(init, _lc_max_##T(a, n)) : init;                  \
+}
+
+_LC_VECTOR_OP_KERNELS(float)
+_LC_VECTOR_OP_KERNELS(double)
+
+static inline int _lc_fold_add_int(const int *a, lc_index_t n, int init) {
+  return (int)((unsigned)init + (unsigned)_lc_sum_int(a, n));
+}
+static inline int _lc_fold_min_int(const int *a, lc_index_t n, int init) {
+  return n ? _LC_OP_min(init, _lc_min_int(a, n)) : init;
+}
+static inline int _lc_fold_max_int(const int *a, lc_index_t n, int init) {
+  return n ? _LC_OP_max(init, _lc_max_int(a, n)) : init;
+}
+
+/* _Generic associations of fold_op, keyed by acc_type (*)(element_type). */
+#define _LC_KERNELS_add \
+  char (*)(char): _lc_fold_add_char, \
+  signed char (*)(signed char): _lc_fold_add_schar, \
+  unsigned char (*)(unsigned char): _lc_fold_add_uchar, \
+  short (*)(short): _lc_fold_add_short, \
+  unsigned short (*)(unsigned short): _lc_fold_add_ushort, \
+  int (*)(int): _lc_fold_add_int, \
+  unsigned (*)(unsigned): _lc_fold_add_uint, \
+  long (*)(long): _lc_fold_add_long, \
+  unsigned long (*)(unsigned long): _lc_fold_add_ulong, \
+  long long (*)(long long): _lc_fold_add_llong, \
+  unsigned long long (*)(unsigned long long): _lc_fold_add_ullong, \
+  float (*)(float): _lc_fold_add_float, \
+  double (*)(double): _lc_fold_add_double
+#define _LC_KERNELS_mul \
+  char (*)(char): _lc_fold_mul_char, \
+  signed char (*)(signed char): _lc_fold_mul_schar, \
+  unsigned char (*)(unsigned char): _lc_fold_mul_uchar, \
+  short (*)(short): _lc_fold_mul_short, \
+  unsigned short (*)(unsigned short): _lc_fold_mul_ushort, \
+  int (*)(int): _lc_fold_mul_int, \
+  unsigned (*)(unsigned): _lc_fold_mul_uint, \
+  long (*)(long): _lc_fold_mul_long, \
+  unsigned long (*)(unsigned long): _lc_fold_mul_ulong, \
+  long long (*)(long long): _lc_fold_mul_llong, \
+  unsigned long long (*)(unsigned long long): _lc_fold_mul_ullong, \
+  float (*)(float): _lc_fold_mul_float, \
+  double (*)(double): _lc_fold_mul_double
+#define _LC_KERNELS_min \
+  char (*)(char): _lc_fold_min_char, \
+  signed char (*)(signed char): _lc_fold_min_schar, \
+  unsigned char (*)(unsigned char): _lc_fold_min_uchar, \
+  short (*)(short): _lc_fold_min_short, \
+  unsigned short (*)(unsigned short): _lc_fold_min_ushort, \
+  int (*)(int): _lc_fold_min_int, \
+  unsigned (*)(unsigned): _lc_fold_min_uint, \
+  long (*)(long): _lc_fold_min_long, \
+  unsigned long (*)(unsigned long): _lc_fold_min_ulong, \
+  long long (*)(long long): _lc_fold_min_llong, \
+  unsigned long long (*)(unsigned long long): _lc_fold_min_ullong, \
+  float (*)(float): _lc_fold_min_float, \
+  double (*)(double): _lc_fold_min_double
+#define _LC_KERNELS_max \
+  char (*)(char): _lc_fold_max_char, \
+  signed char (*)(signed char): _lc_fold_max_schar, \
+  unsigned char (*)(unsigned char): _lc_fold_max_uchar, \
+  short (*)(short): _lc_fold_max_short, \
+  unsigned short (*)(unsigned short): _lc_fold_max_ushort, \
+  int (*)(int): _lc_fold_max_int, \
+  unsigned (*)(unsigned): _lc_fold_max_uint, \
+  long (*)(long): _lc_fold_max_long, \
+  unsigned long (*)(unsigned long): _lc_fold_max_ulong, \
+  long long (*)(long long): _lc_fold_max_llong, \
+  unsigned long long (*)(unsigned long long): _lc_fold_max_ullong, \
+  float (*)(float): _lc_fold_max_float, \
+  double (*)(double): _lc_fold_max_double
+#define _LC_KERNELS_xor \
+  char (*)(char): _lc_fold_xor_char, \
+  signed char (*)(signed char): _lc_fold_xor_schar, \
+  unsigned char (*)(unsigned char): _lc_fold_xor_uchar, \
+  short (*)(short): _lc_fold_xor_short, \
+  unsigned short (*)(unsigned short): _lc_fold_xor_ushort, \
+  int (*)(int): _lc_fold_xor_int, \
+  unsigned (*)(unsigned): _lc_fold_xor_uint, \
+  long (*)(long): _lc_fold_xor_long, \
+  unsigned long (*)(unsigned long): _lc_fold_xor_ulong, \
+  long long (*)(long long): _lc_fold_xor_llong, \
+  unsigned long long (*)(unsigned long long): _lc_fold_xor_ullong
+
+#define _LC_SIMD_SELECT(name, in_array) _Generic((in_array)[0], \
+  double: _lc_##name##_double,                                  \
+  float: _lc_##name##_float,                                    \
+  int: _lc_##name##_int)
+
+/**
+ * @brief Sum of the elements of an array of double, float or int.
+ *
+ * The elements are added in several interleaved partial sums, so for
+ * floating point types the rounding may differ from the one of the
+ * sequential fold. Sums of int wrap around on overflow.
+ *
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ *
+ * Usage:
+ * @code
+ *   double total = fold_sum(numbers, n);
+ * @endcode
+ */
+#define fold_sum(in_array, size) \
+  _LC_SIMD_SELECT(sum, in_array)(&(in_array)[0], size)
+
+/**
+ * @brief Smallest element of an array of double, float or int.
+ *
+ * An empty array yields the largest value of the type (HUGE_VAL for
+ * floating point types).
+ *
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ */
+#define fold_min(in_array, size) \
+  _LC_SIMD_SELECT(min, in_array)(&(in_array)[0], size)
+
+/**
+ * @brief Largest element of an array of double, float or int.
+ *
+ * An empty array yields the smallest value of the type (-HUGE_VAL for
+ * floating point types).
+ *
+ * @param in_array  The input array.
+ * @param size      The number of elements in the input array.
+ */
+#define fold_max(in_array, size) \
+  _LC_SIMD_SELECT(max, in_array)(&(in_array)[0], size)
+
+/**
+ * @brief Dot product of two arrays of double, float or int.
+ *
+ * As for fold_sum, the products are accumulated in several partial sums.
+ *
+ * @param a_array  The first input array.
+ * @param b_array  The second input array, of the same type.
+ * @param size     The number of elements in each array.
+ *
+ * Usage:
+ * @code
+ *   float d = fold_dot(x, y, n);
+ * @endcode
+ */
+#define fold_dot(a_array, b_array, size) \
+  _LC_SIMD_SELECT(dot, a_array)(&(a_array)[0], &(b_array)[0], size)
+
+/* Bit k set when lane k of the 32-byte mask m (of lanes of `lane` bytes) is set. */
+#if defined(__x86_64__) || defined(__i386__)
+#define _LC_MASK_BITS(m, lane) ((unsigned)((lane) == 4                    \
+  ? _mm256_movemask_ps((__m256)(m)) : _mm256_movemask_pd((__m256d)(m))))
+#else
+#define _LC_MASK_BITS(m, lane) ({                                         \
+  unsigned _lc_b = 0;                                                     \
+  for (unsigned _lc_k = 0; _lc_k < 32 / (lane); _lc_k++)                  \
+    _lc_b |= (unsigned)((m)[_lc_k] & 1) << _lc_k;                         \
+  _lc_b; })
+#endif
+
+/*
+ * The vector loop of filter_simd needs a variable lane permutation to
+ * be faster than the branchless scalar loop of filter: only AVX2 has one.
+ * As for fold_sum, the loop is compiled for AVX2 and selected at run time.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define _LC_FILTER_TARGET __attribute__((target("avx2")))
+#define _LC_FILTER_VECTORS __builtin_cpu_supports("avx2")
+#else
+#define _LC_FILTER_TARGET
+#define _LC_FILTER_VECTORS 0
+#endif
+
+/*
+ * Compaction table: for each mask of 8 lanes, the positions of its set
+ * lanes, in order, one per 4-bit nibble. The first 16 entries serve 4 lanes.
+ */
+static const unsigned _lc_compact[256] = {
+  0x00000000, 0x00000000, 0x00000001, 0x00000010, 0x00000002, 0x00000020, 0x00000021, 0x00000210,
+  0x00000003, 0x00000030, 0x00000031, 0x00000310, 0x00000032, 0x00000320, 0x00000321, 0x00003210,
+  0x00000004, 0x00000040, 0x00000041, 0x00000410, 0x00000042, 0x00000420, 0x00000421, 0x00004210,
+  0x00000043, 0x00000430, 0x00000431, 0x00004310, 0x00000432, 0x00004320, 0x00004321, 0x00043210,
+  0x00000005, 0x00000050, 0x00000051, 0x00000510, 0x00000052, 0x00000520, 0x00000521, 0x00005210,
+  0x00000053, 0x00000530, 0x00000531, 0x00005310, 0x00000532, 0x00005320, 0x00005321, 0x00053210,
+  0x00000054, 0x00000540, 0x00000541, 0x00005410, 0x00000542, 0x00005420, 0x00005421, 0x00054210,
+  0x00000543, 0x00005430, 0x00005431, 0x00054310, 0x00005432, 0x00054320, 0x00054321, 0x00543210,
+  0x00000006, 0x00000060, 0x00000061, 0x00000610, 0x00000062, 0x00000620, 0x00000621, 0x00006210,
+  0x00000063, 0x00000630, 0x00000631, 0x00006310, 0x00000632, 0x00006320, 0x00006321, 0x00063210,
+  0x00000064, 0x00000640, 0x00000641, 0x00006410, 0x00000642, 0x00006420, 0x00006421, 0x00064210,
+  0x00000643, 0x00006430, 0x00006431, 0x00064310, 0x00006432, 0x00064320, 0x00064321, 0x00643210,
+  0x00000065, 0x00000650, 0x00000651, 0x00006510, 0x00000652, 0x00006520, 0x00006521, 0x00065210,
+  0x00000653, 0x00006530, 0x00006531, 0x00065310, 0x00006532, 0x00065320, 0x00065321, 0x00653210,
+  0x00000654, 0x00006540, 0x00006541, 0x00065410, 0x00006542, 0x00065420, 0x00065421, 0x00654210,
+  0x00006543, 0x00065430, 0x00065431, 0x00654310, 0x00065432, 0x00654320, 0x00654321, 0x06543210,
+  0x00000007, 0x00000070, 0x00000071, 0x00000710, 0x00000072, 0x00000720, 0x00000721, 0x00007210,
+  0x00000073, 0x00000730, 0x00000731, 0x00007310, 0x00000732, 0x00007320, 0x00007321, 0x00073210,
+  0x00000074, 0x00000740, 0x00000741, 0x00007410, 0x00000742, 0x00007420, 0x00007421, 0x00074210,
+  0x00000743, 0x00007430, 0x00007431, 0x00074310, 0x00007432, 0x00074320, 0x00074321, 0x00743210,
+  0x00000075, 0x00000750, 0x00000751, 0x00007510, 0x00000752, 0x00007520, 0x00007521, 0x00075210,
+  0x00000753, 0x00007530, 0x00007531, 0x00075310, 0x00007532, 0x00075320, 0x00075321, 0x00753210,
+  0x00000754, 0x00007540, 0x00007541, 0x00075410, 0x00007542, 0x00075420, 0x00075421, 0x00754210,
+  0x00007543, 0x00075430, 0x00075431, 0x00754310, 0x00075432, 0x00754320, 0x00754321, 0x07543210,
+  0x00000076, 0x00000760, 0x00000761, 0x00007610, 0x00000762, 0x00007620, 0x00007621, 0x00076210,
+  0x00000763, 0x00007630, 0x00007631, 0x00076310, 0x00007632, 0x00076320, 0x00076321, 0x00763210,
+  0x00000764, 0x00007640, 0x00007641, 0x00076410, 0x00007642, 0x00076420, 0x00076421, 0x00764210,
+  0x00007643, 0x00076430, 0x00076431, 0x00764310, 0x00076432, 0x00764320, 0x00764321, 0x07643210,
+  0x00000765, 0x00007650, 0x00007651, 0x00076510, 0x00007652, 0x00076520, 0x00076521, 0x00765210,
+  0x00007653, 0x00076530, 0x00076531, 0x00765310, 0x00076532, 0x00765320, 0x00765321, 0x07653210,
+  0x00007654, 0x00076540, 0x00076541, 0x00765410, 0x00076542, 0x00765420, 0x00765421, 0x07654210,
+  0x00076543, 0x00765430, 0x00765431, 0x07654310, 0x00765432, 0x07654320, 0x07654321, 0x76543210,
+};
+
+/**
+ * @brief Copies the elements of an array of a primitive type satisfying a
+ * predicate, evaluated on whole vectors.
+ *
+ * The vectorized counterpart of filter, for 32-bit and 64-bit primitive
+ * types (int, unsigned, float, long, double...). The predicate is
+ * evaluated on vectors of 32 bytes of elements: `value` is a GCC
+ * vector, and the predicate yields a lane mask. The kept lanes of each
+ * vector are moved to its front by a shuffle taken from a table, and
+ * the whole vector is stored at the current output position, which
+ * advances by the number of kept lanes. The remaining elements are
+ * processed one at a time with the same predicate.
+ *
+ * The predicate may use arithmetic, bitwise and comparison operators,
+ * which apply lane by lane (`&` and `|` combine comparisons; `&&` and
+ * `||` are not available on vectors). Since the predicate is user code
+ * expanded in place, the vector loop is a nested function compiled for
+ * AVX2, called when the CPU supports it (as for fold_sum, no -mavx2 is
+ * needed). Otherwise every element goes through the scalar branchless
+ * loop, which is then the faster one.
+ *
+ * @param type          The type of the elements in the array.
+ * @param in_array      The input array.
+ * @param size          The number of elements in the input array.
+ * @param body          A block whose last expression statement compares
+ *                      `value`. It must not `return`.
+ * @param out_array     The output array. It must have room for `size`
+ *                      elements, even if fewer are kept. It may be in_array.
+ *
+ * Usage:
+ * @code
+ *   lc_index_t count = filter_simd(double, samples, n,
+ *      { (value > low) & (value < high); }, kept);
+ * @endcode
+ */
+#define filter_simd(type, in_array, size, body, out_array) ({              \
+  typedef type _lc_vec                                                     \
+    __attribute__((vector_size(32), aligned(sizeof(type)), may_alias));    \
+  _Static_assert(sizeof(type) == 4 || sizeof(type) == 8,                   \
+                 "filter_simd works on 32-bit or 64-bit elements");        \
+  const lc_index_t _lc_lanes = sizeof(_lc_vec) / sizeof(type);             \
+  const type *_lc_in = &(in_array)[0];                                     \
+  type *_lc_out = &(out_array)[0];                                         \
+  const lc_index_t _lc_end = (size);                                       \
+  lc_index_t _lc_n = 0, _lc_i = 0;                                         \
+  typedef __typeof__(*__builtin_choose_expr(sizeof(type) == 8,             \
+    (long long *)0, (int *)0)) _lc_lane;                                   \
+  typedef _lc_lane _lc_mask __attribute__((vector_size(32)));              \
+  _lc_mask _lc_shift;                                                      \
+  for (lc_index_t _lc_k = 0; _lc_k < _lc_lanes; _lc_k++)                   \
+    _lc_shift[_lc_k] = 4 * _lc_k;                                          \
+  _LC_FILTER_TARGET lc_index_t _lc_vectors(lc_index_t *_lc_pi) {           \
+    const type *_lc_src = _lc_in;                                          \
+    type *_lc_dst = _lc_out;                                               \
+    lc_index_t _lc_kept = 0, _lc_j = 0;                                    \
+    for (; _lc_j + _lc_lanes <= _lc_end; _lc_j += _lc_lanes) {             \
+      _lc_vec value = *(const _lc_vec *)(_lc_src + _lc_j);                 \
+      _lc_mask _lc_m = (body);                                             \
+      unsigned _lc_bits = _LC_MASK_BITS(_lc_m, sizeof(type));              \
+      _lc_mask _lc_idx = (_lc_mask){0} + (_lc_lane)_lc_compact[_lc_bits];  \
+      *(_lc_vec *)(_lc_dst + _lc_kept) =                                   \
+        __builtin_shuffle(value, (_lc_idx >> _lc_shift) & 7);              \
+      _lc_kept += __builtin_popcount(_lc_bits);                            \
+    }                                                                      \
+    *_lc_pi = _lc_j;                                                       \
+    return _lc_kept;                                                       \
+  }                                                                        \
+  if (_LC_FILTER_VECTORS) _lc_n = _lc_vectors(&_lc_i);                     \
+  for (; _lc_i < _lc_end; _lc_i++) {                                       \
+    type value = _lc_in[_lc_i];                                            \
+    _lc_out[_lc_n] = value;                                                \
+    _lc_n += !!(body);                                                     \
+  }                                                                        \
+  _lc_n; })
+
+#endif
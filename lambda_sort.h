@@ -0,0 +1,309 @@
+/**
+ * @file lambda_sort.h
+ * @brief Sorting arrays with a lambda comparator or key extractor.
+ *
+ * This header file provides sort, an introsort whose comparator body is
+ * a nested function called directly, so GCC inlines it where qsort
+ * calls a function pointer per comparison; sort_by_key, a stable radix
+ * sort on an integer key computed by a lambda body; and psort, which
+ * sorts chunks on the thread pool and merges them.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_sort_h
+#define _lambda_sort_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lambda.h"
+#include "lambda_parallel.h"
+
+/** Ranges of at most this many elements are finished by insertion sort. */
+#ifndef LAMBDA_SORT_INSERTION
+#define LAMBDA_SORT_INSERTION 16
+#endif
+
+/** Allocates the buffers of sort_by_key and psort, released by free; NULL selects their fallback. */
+#ifndef LAMBDA_SORT_ALLOC
+#define LAMBDA_SORT_ALLOC(bytes) malloc(bytes)
+#endif
+
+/*
+ * Sorting networks of 2 to 8 elements, as pairs of positions to compare
+ * and exchange: _lc_network[n] lists _lc_network_size[n] pairs.
+ */
+static const unsigned char _lc_network[9][19][2] = {
+  [2] = { {0,1} },
+  [3] = { {0,2}, {0,1}, {1,2} },
+  [4] = { {0,2}, {1,3}, {0,1}, {2,3}, {1,2} },
+  [5] = { {0,3}, {1,4}, {0,2}, {1,3}, {0,1}, {2,4}, {1,2}, {3,4}, {2,3} },
+  [6] = { {0,5}, {1,3}, {2,4}, {1,2}, {3,4}, {0,3}, {2,5}, {0,1}, {2,3},
+          {4,5}, {1,2}, {3,4} },
+  [7] = { {0,6}, {2,3}, {4,5}, {0,2}, {1,4}, {3,6}, {0,1}, {2,5}, {3,4},
+          {1,2}, {4,6}, {2,3}, {4,5}, {1,2}, {3,4}, {5,6} },
+  [8] = { {0,2}, {1,3}, {4,6}, {5,7}, {0,4}, {1,5}, {2,6}, {3,7}, {0,1},
+          {2,3}, {4,5}, {6,7}, {2,4}, {3,5}, {1,4}, {3,6}, {1,2}, {3,4},
+          {5,6} },
+};
+static const unsigned char _lc_network_size[9] = { 0, 0, 1, 3, 5, 9, 12, 16, 19 };
+
+/*
+ * Define the nested function _lc_sort_range(a, n), sorting a[0..n) by
+ * _𝛌_less, which the caller defines. Introsort: median of three
+ * partitioning, heapsort past 2 log2(n) levels, insertion sort below
+ * LAMBDA_SORT_INSERTION elements and sorting networks below 9.
+ */
+#define _lc_sort_define(type)                                         \
+  void _lc_sort_small(type *_lc_a, lc_index_t _lc_n) {                \
+    if (_lc_n <= 8) {                                                 \
+      for (int _lc_p = 0; _lc_p < _lc_network_size[_lc_n]; _lc_p++) { \
+        type *_lc_x = &_lc_a[_lc_network[_lc_n][_lc_p][0]];           \
+        type *_lc_y = &_lc_a[_lc_network[_lc_n][_lc_p][1]];           \
+        if (_𝛌_less(*_lc_y, *_lc_x)) {                                \
+          type _lc_t = *_lc_x; *_lc_x = *_lc_y; *_lc_y = _lc_t;       \
+        }                                                             \
+      }                                                               \
+      return;                                                         \
+    }                                                                 \
+    for (lc_index_t _lc_i = 1; _lc_i < _lc_n; _lc_i++) {              \
+      type _lc_v = _lc_a[_lc_i];                                      \
+      lc_index_t _lc_j = _lc_i;                                       \
+      for (; _lc_j > 0 && _𝛌_less(_lc_v, _lc_a[_lc_j - 1]); _lc_j--)  \
+        _lc_a[_lc_j] = _lc_a[_lc_j - 1];                              \
+      _lc_a[_lc_j] = _lc_v;                                           \
+    }                                                                 \
+  }                                                                   \
+  void _lc_sift(type *_lc_a, lc_index_t _lc_i, lc_index_t _lc_n) {    \
+    type _lc_v = _lc_a[_lc_i];                                        \
+    for (lc_index_t _lc_c; (_lc_c = 2 * _lc_i + 1) < _lc_n; _lc_i = _lc_c) { \
+      if (_lc_c + 1 < _lc_n && _𝛌_less(_lc_a[_lc_c], _lc_a[_lc_c + 1])) \
+        _lc_c++;                                                      \
+      if (!_𝛌_less(_lc_v, _lc_a[_lc_c])) break;                       \
+      _lc_a[_lc_i] = _lc_a[_lc_c];                                    \
+    }                                                                 \
+    _lc_a[_lc_i] = _lc_v;                                             \
+  }                                                                   \
+  void _lc_heapsort(type *_lc_a, lc_index_t _lc_n) {                  \
+    for (lc_index_t _lc_i = _lc_n / 2; _lc_i-- > 0;)                  \
+      _lc_sift(_lc_a, _lc_i, _lc_n);                                  \
+    for (lc_index_t _lc_i = _lc_n; _lc_i-- > 1;) {                    \
+      type _lc_t = _lc_a[0]; _lc_a[0] = _lc_a[_lc_i]; _lc_a[_lc_i] = _lc_t; \
+      _lc_sift(_lc_a, 0, _lc_i);                                      \
+    }                                                                 \
+  }                                                                   \
+  void _lc_introsort(type *_lc_a, lc_index_t _lc_n, int _lc_depth) {  \
+    while (_lc_n > LAMBDA_SORT_INSERTION) {                           \
+      if (_lc_depth-- == 0) {                                         \
+        _lc_heapsort(_lc_a, _lc_n);                                   \
+        return;                                                       \
+      }                                                               \
+      /* Median of the first, middle and last elements, moved to 0 */ \
+      type *_lc_m = &_lc_a[_lc_n / 2], *_lc_l = &_lc_a[_lc_n - 1];    \
+      if (_𝛌_less(*_lc_m, *_lc_a)) { type _lc_t = *_lc_m; *_lc_m = *_lc_a; *_lc_a = _lc_t; } \
+      if (_𝛌_less(*_lc_l, *_lc_m)) { type _lc_t = *_lc_m; *_lc_m = *_lc_l; *_lc_l = _lc_t; \
+        if (_𝛌_less(*_lc_m, *_lc_a)) { type _lc_u = *_lc_m; *_lc_m = *_lc_a; *_lc_a = _lc_u; } } \
+      { type _lc_t = *_lc_m; *_lc_m = *_lc_a; *_lc_a = _lc_t; }       \
+      type _lc_pivot = _lc_a[0];                                      \
+      lc_index_t _lc_i = 0, _lc_j = _lc_n;                            \
+      for (;;) {                                                      \
+        do _lc_i++; while (_𝛌_less(_lc_a[_lc_i], _lc_pivot));         \
+        do _lc_j--; while (_𝛌_less(_lc_pivot, _lc_a[_lc_j]));         \
+        if (_lc_i >= _lc_j) break;                                    \
+        type _lc_t = _lc_a[_lc_i]; _lc_a[_lc_i] = _lc_a[_lc_j]; _lc_a[_lc_j] = _lc_t; \
+      }                                                               \
+      _lc_a[0] = _lc_a[_lc_j]; _lc_a[_lc_j] = _lc_pivot;              \
+      /* Recurse into the smaller side, loop on the larger one */     \
+      if (_lc_j < _lc_n - _lc_j - 1) {                                \
+        _lc_introsort(_lc_a, _lc_j, _lc_depth);                       \
+        _lc_a += _lc_j + 1; _lc_n -= _lc_j + 1;                       \
+      } else {                                                        \
+        _lc_introsort(_lc_a + _lc_j + 1, _lc_n - _lc_j - 1, _lc_depth); \
+        _lc_n = _lc_j;                                                \
+      }                                                               \
+    }                                                                 \
+    _lc_sort_small(_lc_a, _lc_n);                                     \
+  }                                                                   \
+  void _lc_sort_range(type *_lc_a, lc_index_t _lc_n) {                \
+    int _lc_depth = 0;                                                \
+    for (lc_index_t _lc_k = _lc_n; _lc_k > 1; _lc_k >>= 1) _lc_depth += 2; \
+    _lc_introsort(_lc_a, _lc_n, _lc_depth);                           \
+  }
+
+/**
+ * @brief Sorts an array in place with a lambda comparator.
+ *
+ * An introsort (quicksort falling back on heapsort, hence O(n log n)
+ * in the worst case) finishing small ranges with sorting networks and
+ * insertion sort. The comparator body is a nested function called
+ * directly, even with trampolines, which GCC inlines into the loops.
+ * The sort is not stable.
+ *
+ * @param type      The type of the elements in the array.
+ * @param in_array  The array to sort.
+ * @param size      The number of elements in the array.
+ * @param body      The lambda function body returning non-zero when `a`
+ *                  must come before `b` (a strict weak ordering, as
+ *                  `a < b`).
+ *
+ * Usage:
+ * @code
+ *   // Sort records by decreasing score
+ *   sort(record, records, n, { return a.score > b.score; });
+ * @endcode
+ */
+#define sort(type, in_array, size, body) ({                           \
+  int _𝛌_less(type a, type b) body                                    \
+  _lc_sort_define(type)                                               \
+  _lc_sort_range(&(in_array)[0], (size));                             \
+  ; })
+
+/*
+ * Unsigned image of an integer key, ordered as the key: the key is
+ * truncated to its own width, so that narrow signed keys are not sign
+ * extended, then the sign bit of signed keys is flipped.
+ */
+#define _lc_key_bits(key_type, k)                                     \
+  (((uint64_t)(k) & (~(uint64_t)0 >> (64 - 8 * sizeof(key_type))))   \
+   ^ ((key_type)-1 < (key_type)1 ? (uint64_t)1 << (8 * sizeof(key_type) - 1) : 0))
+
+/**
+ * @brief Sorts an array in place by an integer key, with a stable radix
+ * sort.
+ *
+ * One pass per byte of the key (least significant first), a pass being
+ * skipped when all the keys share that byte. The key body is evaluated
+ * once per element and pass. A buffer of `size` elements is allocated;
+ * when it cannot be, the array is sorted by sort on the keys instead
+ * (not stably).
+ *
+ * @param type      The type of the elements in the array.
+ * @param key_type  The integer type of the keys, signed or not.
+ * @param in_array  The array to sort.
+ * @param size      The number of elements in the array.
+ * @param key_body  The lambda function body returning the key of `value`.
+ *
+ * Usage:
+ * @code
+ *   sort_by_key(record, uint32_t, records, n, { return value.id; });
+ * @endcode
+ */
+#define sort_by_key(type, key_type, in_array, size, key_body) ({      \
+  type *_lc_a = &(in_array)[0];                                       \
+  const lc_index_t _lc_n = (size);                                    \
+  key_type _𝛌_k(type value) key_body                                  \
+  uint64_t _𝛌_key(type _lc_v) { return _lc_key_bits(key_type, _𝛌_k(_lc_v)); } \
+  type *_lc_buf = _lc_n > 1 ? LAMBDA_SORT_ALLOC(_lc_n * sizeof(type)) : NULL; \
+  if (_lc_buf) {                                                      \
+    /* Histograms of every byte of the keys, in one pass */           \
+    lc_index_t _lc_hist[sizeof(key_type)][256];                       \
+    memset(_lc_hist, 0, sizeof(_lc_hist));                            \
+    for (lc_index_t _lc_i = 0; _lc_i < _lc_n; _lc_i++) {              \
+      uint64_t _lc_k = _𝛌_key(_lc_a[_lc_i]);                          \
+      for (unsigned _lc_b = 0; _lc_b < sizeof(key_type); _lc_b++)     \
+        _lc_hist[_lc_b][(_lc_k >> (8 * _lc_b)) & 255]++;              \
+    }                                                                 \
+    type *_lc_src = _lc_a, *_lc_dst = _lc_buf;                        \
+    for (unsigned _lc_b = 0; _lc_b < sizeof(key_type); _lc_b++) {     \
+      lc_index_t *_lc_h = _lc_hist[_lc_b], _lc_sum = 0;               \
+      if (_lc_h[(_𝛌_key(_lc_a[0]) >> (8 * _lc_b)) & 255] == _lc_n)    \
+        continue;                                                     \
+      for (int _lc_d = 0; _lc_d < 256; _lc_d++) {                     \
+        lc_index_t _lc_c = _lc_h[_lc_d];                              \
+        _lc_h[_lc_d] = _lc_sum;                                       \
+        _lc_sum += _lc_c;                                             \
+      }                                                               \
+      for (lc_index_t _lc_i = 0; _lc_i < _lc_n; _lc_i++)              \
+        _lc_dst[_lc_h[(_𝛌_key(_lc_src[_lc_i]) >> (8 * _lc_b)) & 255]++] = _lc_src[_lc_i]; \
+      type *_lc_t = _lc_src; _lc_src = _lc_dst; _lc_dst = _lc_t;      \
+    }                                                                 \
+    if (_lc_src != _lc_a) memcpy(_lc_a, _lc_src, _lc_n * sizeof(type)); \
+    free(_lc_buf);                                                    \
+  } else {                                                            \
+    sort(type, _lc_a, _lc_n, { return _𝛌_k(a) < _𝛌_k(b); });          \
+  }                                                                   \
+  ; })
+
+/**
+ * @brief Sorts an array in place using several threads.
+ *
+ * The array is split into `nthreads` contiguous chunks, each sorted by
+ * sort on a thread of the pool, then the sorted runs are merged pairwise
+ * through a buffer of `size` elements, the merges of a round running in
+ * parallel. When the buffer cannot be allocated, the array is sorted by
+ * sort in the calling thread.
+ *
+ * @param type      The type of the elements in the array.
+ * @param in_array  The array to sort.
+ * @param size      The number of elements in the array.
+ * @param body      The lambda function body comparing `a` and `b`, as in sort.
+ * @param nthreads  The number of chunks, hence of threads at most.
+ *
+ * Usage:
+ * @code
+ *   psort(double, samples, n, { return a < b; }, 8);
+ * @endcode
+ */
+#define psort(type, in_array, size, body, nthreads) ({                \
+  type *_lc_a = &(in_array)[0];                                       \
+  const lc_index_t _lc_size = (size);                                 \
+  int _lc_nt = (nthreads) < 1 ? 1 : (nthreads);                       \
+  if ((lc_index_t)_lc_nt > _lc_size / LAMBDA_SORT_INSERTION)          \
+    _lc_nt = _lc_size / LAMBDA_SORT_INSERTION ? _lc_size / LAMBDA_SORT_INSERTION : 1; \
+  int _𝛌_less(type a, type b) body                                    \
+  _lc_sort_define(type)                                               \
+  type *_lc_buf = _lc_nt > 1 ? LAMBDA_SORT_ALLOC(_lc_size * sizeof(type)) : NULL; \
+  if (!_lc_buf) {                                                     \
+    _lc_sort_range(_lc_a, _lc_size);                                  \
+  } else {                                                            \
+    lc_index_t _𝛌_bound(int _lc_t) { return _lc_size * _lc_t / _lc_nt; } \
+    void _𝛌_chunk(int _lc_t) {                                        \
+      _lc_sort_range(_lc_a + _𝛌_bound(_lc_t),                         \
+                     _𝛌_bound(_lc_t + 1) - _𝛌_bound(_lc_t));          \
+    }                                                                 \
+    _lc_parallel(_lc_nt, _𝛌_chunk);                                   \
+    /* Runs of `_lc_width` chunks are merged by pairs from src to dst */ \
+    type *_lc_src = _lc_a, *_lc_dst = _lc_buf;                        \
+    int _lc_width = 1;                                                \
+    void _𝛌_merge(int _lc_p) {                                        \
+      int _lc_c = 2 * _lc_p * _lc_width;                              \
+      lc_index_t _lc_lo = _𝛌_bound(_lc_c);                            \
+      lc_index_t _lc_mid = _𝛌_bound(_lc_c + _lc_width < _lc_nt ? _lc_c + _lc_width : _lc_nt); \
+      lc_index_t _lc_hi = _𝛌_bound(_lc_c + 2 * _lc_width < _lc_nt ? _lc_c + 2 * _lc_width : _lc_nt); \
+      lc_index_t _lc_i = _lc_lo, _lc_j = _lc_mid, _lc_o = _lc_lo;     \
+      while (_lc_i < _lc_mid && _lc_j < _lc_hi)                       \
+        _lc_dst[_lc_o++] = _𝛌_less(_lc_src[_lc_j], _lc_src[_lc_i]) ?  \
+                           _lc_src[_lc_j++] : _lc_src[_lc_i++];       \
+      memcpy(_lc_dst + _lc_o, _lc_src + _lc_i, (_lc_mid - _lc_i) * sizeof(type)); \
+      _lc_o += _lc_mid - _lc_i;                                       \
+      memcpy(_lc_dst + _lc_o, _lc_src + _lc_j, (_lc_hi - _lc_j) * sizeof(type)); \
+    }                                                                 \
+    for (; _lc_width < _lc_nt; _lc_width *= 2) {                      \
+      _lc_parallel((_lc_nt + 2 * _lc_width - 1) / (2 * _lc_width), _𝛌_merge); \
+      type *_lc_t = _lc_src; _lc_src = _lc_dst; _lc_dst = _lc_t;      \
+    }                                                                 \
+    if (_lc_src != _lc_a) memcpy(_lc_a, _lc_src, _lc_size * sizeof(type)); \
+    free(_lc_buf);                                                    \
+  }                                                                   \
+  ; })
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * @file lambda_task.h
+ * @brief Fork/join tasks on work-stealing deques, for recursive parallelism.
+ *
+ * This header file provides spawn and join. spawn makes a lambda body a
+ * task that may run on another thread, join waits for the tasks spawned
+ * by the current task (or, outside any task, by the current thread):
+ * @code
+ *   long tree_sum(Node *n) {
+ *     if (n == NULL) return 0;
+ *     long left;
+ *     spawn({ left = tree_sum(n->left); });
+ *     long right = tree_sum(n->right);
+ *     join();
+ *     return n->value + left + right;
+ *   }
+ * @endcode
+ *
+ * Each thread pushes the tasks it spawns at the bottom of its own deque
+ * (Chase and Lev) and pops them back from there, most recent first. The
+ * workers of lambda_pool.h, and the threads waiting in join, steal the
+ * oldest tasks at the top of the other deques. A task is a nested
+ * function, which reads and writes the variables of the function that
+ * spawned it: that function must therefore join before it returns,
+ * which keeps its frame alive while the task may run. Every task also
+ * joins its own tasks when its body ends.
+ *
+ * A thread waiting in join runs its own tasks and steals others, so
+ * nested fork/join never blocks a thread while work is pending. When the
+ * deque of a thread is full, spawn runs the task at once.
+ *
+ * Handing a lambda to another thread needs its address, hence a
+ * trampoline. With LAMBDA_NO_TRAMPOLINE spawn runs the body at once,
+ * in the calling thread, and join has nothing to wait for: there is no
+ * parallelism at all. lambda_pool.h warns about it at compile time
+ * unless LAMBDA_NX_SERIAL is defined.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of the LambdaCraft project.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft  is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles.Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#ifndef _lambda_task_h
+#define _lambda_task_h
+
+#include <stdlib.h>
+#include "lambda.h"
+#include "lambda_pool.h"
+
+/** Capacity of the deque of each thread, in tasks. */
+#ifndef LAMBDA_TASK_DEQUE
+#define LAMBDA_TASK_DEQUE 1024
+#endif
+
+/** Maximum number of threads owning a deque. */
+#ifndef LAMBDA_TASK_THREADS
+#define LAMBDA_TASK_THREADS 256
+#endif
+
+/* The tasks spawned by a task, not finished yet (plus _LC_POOL_SLEEPING). */
+typedef struct {
+  int pending;
+} _lc_frame;
+
+typedef struct {
+  void (*fn)(void);
+  _lc_frame *frame;
+} _lc_task;
+
+typedef struct {
+  long top;
+  char _pad0[64];
+  long bottom;
+  char _pad1[64];
+  _lc_task tasks[LAMBDA_TASK_DEQUE];
+} _lc_deque;
+
+/* Deques of all threads, shared by every translation unit. */
+typedef struct {
+  int count;
+  _lc_deque *deques[LAMBDA_TASK_THREADS];
+} _lc_task_registry;
+
+__attribute__((weak)) _lc_task_registry _lc_tasks;
+__attribute__((weak)) __thread _lc_deque *_lc_task_deque;
+__attribute__((weak)) __thread int _lc_task_nodeque;
+__attribute__((weak)) __thread _lc_frame *_lc_task_frame;
+__attribute__((weak)) __thread _lc_frame _lc_task_root;
+__attribute__((weak)) __thread unsigned _lc_task_seed;
+
+static inline int _lc_task_steal(void);
+
+/* Deque of the calling thread, created on its first spawn; NULL if none is left. */
+static inline _lc_deque *_lc_task_own(void) {
+  if (_lc_task_deque || _lc_task_nodeque) return _lc_task_deque;
+  lc_pool_size();
+  __atomic_store_n(&_lc_pool.steal, _lc_task_steal, __ATOMIC_RELEASE);
+  int index = __atomic_fetch_add(&_lc_tasks.count, 1, __ATOMIC_RELAXED);
+  _lc_deque *deque = index < LAMBDA_TASK_THREADS ? calloc(1, sizeof(_lc_deque)) : NULL;
+  if (!deque) {
+    _lc_task_nodeque = 1;
+    return NULL;
+  }
+  __atomic_store_n(&_lc_tasks.deques[index], deque, __ATOMIC_RELEASE);
+  return _lc_task_deque = deque;
+}
+
+/* Chase-Lev deque: the owner pushes and pops at the bottom. */
+static inline int _lc_deque_push(_lc_deque *d, _lc_task task) {
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+  long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  if (b - t >= LAMBDA_TASK_DEQUE) return 0;
+  _lc_task *slot = &d->tasks[b % LAMBDA_TASK_DEQUE];
+  __atomic_store_n(&slot->fn, task.fn, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->frame, task.frame, __ATOMIC_RELAXED);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+static inline int _lc_deque_pop(_lc_deque *d, _lc_task *task) {
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+  if (t > b) {
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  *task = d->tasks[b % LAMBDA_TASK_DEQUE];
+  if (t < b) return 1;
+  /* Last task: race the thieves for it. */
+  int won = __atomic_compare_exchange_n(&d->top, &t, t + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  return won;
+}
+
+/* Thieves take the oldest task at the top. */
+static inline int _lc_deque_steal(_lc_deque *d, _lc_task *task) {
+  long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b) return 0;
+  _lc_task *slot = &d->tasks[t % LAMBDA_TASK_DEQUE];
+  task->fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+  task->frame = __atomic_load_n(&slot->frame, __ATOMIC_RELAXED);
+  return __atomic_compare_exchange_n(&d->top, &t, t + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline void lc_join(void);
+
+/* Run a task in a frame of its own, join its tasks, then report to its parent. */
+static inline void _lc_task_run(_lc_task task) {
+  _lc_frame frame = { 0 };
+  _lc_frame *parent = _lc_task_frame;
+  _lc_task_frame = &frame;
+  task.fn();
+  lc_join();
+  _lc_task_frame = parent;
+  if (__atomic_fetch_sub(&task.frame->pending, 1, __ATOMIC_ACQ_REL) == (_LC_POOL_SLEEPING | 1))
+    _lc_futex_wake(&task.frame->pending, 1);
+}
+
+/* Steal a task from another deque, starting from a random one, and run it. */
+static inline int _lc_task_steal(void) {
+  int count = __atomic_load_n(&_lc_tasks.count, __ATOMIC_ACQUIRE);
+  if (count > LAMBDA_TASK_THREADS) count = LAMBDA_TASK_THREADS;
+  if (count == 0) return 0;
+  unsigned x = _lc_task_seed ? _lc_task_seed : (unsigned)(size_t)&_lc_task_seed | 1;
+  x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+  _lc_task_seed = x;
+  for (int i = 0; i < count; i++) {
+    _lc_deque *d = __atomic_load_n(&_lc_tasks.deques[(x + i) % count], __ATOMIC_ACQUIRE);
+    _lc_task task;
+    if (d && d != _lc_task_deque && _lc_deque_steal(d, &task)) {
+      _lc_task_run(task);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Spawn fn() as a task, which may run on another thread until
+ * the next lc_join of the calling task.
+ *
+ * @param fn  The task, a pointer to a function (a lambda) without argument.
+ *
+ * Usage:
+ * @code
+ *   lc_spawn(𝛌(void, (void), { left = tree_sum(n->left); }));
+ *   right = tree_sum(n->right);
+ *   lc_join();
+ * @endcode
+ */
+static inline void lc_spawn(void (*fn)(void)) {
+  _lc_frame *frame = _lc_task_frame ? _lc_task_frame : &_lc_task_root;
+  _lc_task task = { fn, frame };
+  _lc_deque *d = _lc_task_own();
+  __atomic_fetch_add(&frame->pending, 1, __ATOMIC_RELAXED);
+  if (d && _lc_deque_push(d, task))
+    _lc_pool_notify(1);
+  else
+    _lc_task_run(task);
+}
+
+/**
+ * @brief Wait for every task spawned by the calling task (or thread).
+ *
+ * The calling thread runs its own pending tasks, then steals tasks from
+ * other threads, and sleeps only once nothing is left to run.
+ */
+static inline void lc_join(void) {
+  _lc_frame *frame = _lc_task_frame ? _lc_task_frame : &_lc_task_root;
+  _lc_deque *d = _lc_task_deque;
+  for (int spin = 0;; spin++) {
+    int pending = __atomic_load_n(&frame->pending, __ATOMIC_ACQUIRE);
+    if (pending == 0) break;
+    _lc_task task;
+    if (d && _lc_deque_pop(d, &task)) {
+      _lc_task_run(task);
+      spin = 0;
+    } else if (_lc_task_steal()) {
+      spin = 0;
+    } else if (spin < LAMBDA_POOL_SPIN) {
+      _lc_pause();
+    } else if (__atomic_compare_exchange_n(&frame->pending, &pending, pending | _LC_POOL_SLEEPING,
+                                           0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      _lc_futex_wait(&frame->pending, pending | _LC_POOL_SLEEPING);
+      __atomic_fetch_and(&frame->pending, ~_LC_POOL_SLEEPING, __ATOMIC_ACQ_REL);
+    }
+  }
+}
+
+/**
+ * @brief Spawn a lambda body as a task.
+ *
+ * The body runs with read and write access to the variables of the
+ * enclosing function, possibly on another thread, at the latest when
+ * the enclosing function calls join. Variables changed between spawn
+ * and join (a loop counter, for instance) must not be read by the body.
+ *
+ * @param body  Body of the task, enclosed in braces.
+ *
+ * Usage:
+ * @code
+ *   long left;
+ *   spawn({ left = tree_sum(n->left); });
+ *   long right = tree_sum(n->right);
+ *   join();
+ * @endcode
+ */
+#ifdef LAMBDA_NO_TRAMPOLINE
+/* Serial: see the warning of lambda_pool.h. */
+#define spawn(body) ({ void _𝛌_task(void) body; _𝛌_task(); })
+#else
+#define spawn(body) lc_spawn(𝛌(void, (void), body))
+#endif
+
+/**
+ * @brief Wait for the tasks spawned by the calling task (or thread).
+ *
+ * Every function spawning tasks must join before returning.
+ */
+#define join() lc_join()
+
+#endif
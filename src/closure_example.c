@@ -0,0 +1,68 @@
+/**
+ * @file closure_example.c
+ * @brief Example of fat closures stored in a structure and called back.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include "lambda.h"
+
+// Environment of the scaling closure
+typedef struct {
+  double factor;
+  double offset;
+} scale_env;
+
+typedef closure_t(double, scale_env, double) scale_closure;
+
+// The closure function captures nothing: its environment is explicit
+static double scale_fn(scale_env *env, double x) {
+    return x * env->factor + env->offset;
+}
+
+// A callback API storing the closure and calling it later
+typedef struct {
+  scale_closure transform;
+  int calls;
+} pipeline_t;
+
+static double pipeline_run(pipeline_t *p, double x) {
+    p->calls++;
+    return closure_call(p->transform, x);
+}
+
+int main(int argc, char **argv) {
+    scale_env celsius_to_fahrenheit = { 1.8, 32.0 };
+    pipeline_t p = { closure(scale_closure, scale_fn, &celsius_to_fahrenheit), 0 };
+
+    double temperatures[4] = { -40.0, 0.0, 37.0, 100.0 };
+    for (int i = 0; i < 4; i++) {
+        printf("%6.1f C = %6.1f F\n", temperatures[i], pipeline_run(&p, temperatures[i]));
+    }
+
+    // Changing the environment changes the behaviour of the stored closure
+    celsius_to_fahrenheit.offset = 0.0;
+    double boiling = pipeline_run(&p, 100.0);
+    printf("Without offset: %.1f, %d calls\n", boiling, p.calls);
+
+    return 0;
+}
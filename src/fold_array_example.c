@@ -24,7 +24,8 @@
  */
 
 #include <stdio.h>
-#include "lambda.h"
+#include "lambda_parallel.h"
+#include "lambda_simd.h"
 
 int main(int argc, char **argv) {
     // Nested value for the fold operation
@@ -43,6 +44,45 @@ int main(int argc, char **argv) {
     // Display the result
     printf("%f\n", result);
 
+    // Same fold split over 3 threads, partial sums merged in chunk order
+    double presult = pfold(
+        double, double, numbers, 9,
+        {return acc + value + nestedValue;},
+        {return acc + value;},
+        0.0, 3
+    );
+    printf("%f\n", presult);
+
+    // Running totals, and the offset of each element, over 3 threads
+    double totals[9], offsets[9];
+    scan(double, double, numbers, 9, {return acc + value;}, 0.0, totals);
+    pexscan(double, double, numbers, 9,
+        {return acc + value;},
+        {return acc + value;},
+        0.0, offsets, 3
+    );
+    for (int i = 0; i < 9; i++) {
+        printf("%f: total %f, offset %f\n", numbers[i], totals[i], offsets[i]);
+    }
+
+    // Plain sum and bounds, computed by vector kernels
+    printf("%f in [%f, %f]\n", fold_sum(numbers, 9), fold_min(numbers, 9), fold_max(numbers, 9));
+
+    // The same sum and product through the operator tags of fold
+    printf("%f %f\n", fold(double, double, numbers, 9, LC_ADD, 0.0),
+        fold(double, double, numbers, 9, LC_MUL, 1.0));
+
+    // Scans stopping early: the first value above 5, whether all values are
+    // positive, and the sum of the first values while it stays below 10
+    lc_index_t above = index_of(double, numbers, 9, {return value > 5.0;});
+    printf("First above 5: %f at %zu, all positive: %d\n", numbers[above], (size_t)above,
+        all(double, numbers, 9, {return value > 0.0;}));
+    double budget = fold_until(double, double, numbers, 9, {
+        if (acc + value > 10.0) { stop = 1; return acc; }
+        return acc + value;
+    }, 0.0);
+    printf("Sum up to 10: %f\n", budget);
+
     return 0;
 }
 
@@ -24,9 +24,9 @@
  */
 
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
-#include "lambda.h"
+#include "lambda_arena.h"
+#include "lambda_parallel.h"
 
 // Define a linked list structure
 typedef struct linked_struct_s {
@@ -35,14 +35,16 @@ typedef struct linked_struct_s {
 } linked_s;
 
 int main(int argc, char **argv) {
-    // Construct a linked list from command line arguments using fold
-    linked_s *ls = fold(linked_s *, char *, argv, argc, 
+    // Construct a linked list from command line arguments using fold,
+    // its nodes being allocated from an arena
+    lc_arena nodes = LC_ARENA_INIT;
+    linked_s *ls = fold_arena(linked_s *, char *, argv, argc, 
     { 
-      linked_s *le = malloc(sizeof(linked_s));
+      linked_s *le = lc_arena_new(arena, linked_s);
       le->next = acc;
       le->item = value;
       return le;
-    }, NULL);
+    }, NULL, &nodes);
     
     // Calculate the total length of all command line arguments using fold_s
     int total_length = fold_s(int, linked_s *, ls, 
@@ -50,8 +52,39 @@ int main(int argc, char **argv) {
       { return acc + strlen(value->item); }, 0);
     printf("Total length: %d\n", total_length);
 
-    // Free memory of each linked list node using foreach_s
-    foreach_s(linked_s *, ls, { linked_s *r=value->next; free(value); return r; });
+    // Same total by batches of 4 nodes
+    int batch_length = fold_s_batch(int, linked_s *, ls,
+      { return value->next; },
+      { return acc + strlen(value->item); }, 0, 4);
+    printf("Total length by batches: %d\n", batch_length);
+
+    typedef vec_t(linked_s *) node_vec;
+
+    // Same total on 2 threads, the list being split every 2 nodes
+    node_vec splits = LC_VEC_INIT;
+    split_s(linked_s *, ls, { return value->next; }, 2, &splits);
+    int parallel_length = pfold_s_splits(int, linked_s *, splits.data, splits.size,
+      { return value->next; },
+      { return acc + strlen(value->item); },
+      { return acc + value; }, 0, 2);
+    printf("Total length on 2 threads: %d\n", parallel_length);
+    vec_free(&splits);
+
+    // Gather the nodes into an array once, then fold the array
+    node_vec gathered = LC_VEC_INIT;
+    collect_s(linked_s *, ls, { return value->next; }, &gathered);
+    size_t longest = fold(size_t, linked_s *, gathered.data, gathered.size,
+      { size_t l = strlen(value->item); return l > acc ? l : acc; }, 0);
+    printf("%zu nodes, longest item: %zu\n", gathered.size, longest);
+    vec_free(&gathered);
+
+    // Look for an option among the arguments, stopping at the first one
+    linked_s *option = find_s(linked_s *, ls, { return value->next; },
+      { return value->item[0] == '-'; });
+    printf("First option: %s\n", option ? option->item : "none");
+
+    // Free memory of every linked list node at once
+    lc_arena_release(&nodes);
 
     return 0;
 }
@@ -0,0 +1,96 @@
+/**
+ * @file group_by_example.c
+ * @brief Example of per-key aggregation and joins with lambda_hash.h.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "lambda_hash.h"
+
+// Define a sale record
+typedef struct {
+  int store;
+  int quantity;
+  double price;
+} sale_t;
+
+// Define a store record
+typedef struct {
+  int id;
+  const char *city;
+} store_t;
+
+typedef hash_table_t(int, double) total_table;
+typedef hash_table_t(int, long) count_table;
+
+int main(int argc, char **argv) {
+    const int n = 100000, stores = 7;
+    sale_t *sales = malloc(n * sizeof(sale_t));
+    for (int i = 0; i < n; i++) {
+        sales[i] = (sale_t){ (i * 37) % stores, 1 + i % 5, (i % 100) / 4.0 };
+    }
+
+    // Revenue per store
+    total_table revenue = LC_HASH_INIT;
+    size_t count = reduce_by_key(int, double, sale_t, sales, n,
+        { return value.store; },
+        { return acc + value.quantity * value.price; }, 0.0, &revenue);
+    printf("%zu stores\n", count);
+    for (int s = 0; s < stores; s++) {
+        printf("store %d: revenue %.2f\n", s, *hash_find(&revenue, s));
+    }
+
+    // Items sold per store, on 4 threads, each filling a table merged at the end
+    count_table items = LC_HASH_INIT;
+    preduce_by_key(int, long, sale_t, sales, n,
+        { return value.store; },
+        { return acc + value.quantity; },
+        { return acc + value; }, 0, &items, 4);
+    long total = 0;
+    hash_foreach(&items, { total += value; });
+    printf("items sold: %ld, store 3: %ld\n", total, *hash_find(&items, 3));
+    printf("store 9 found: %s\n", hash_find(&items, 9) ? "yes" : "no");
+
+    // Upsert directly: histogram of quantities
+    count_table histogram = LC_HASH_INIT;
+    for (int i = 0; i < n; i++) {
+        (*hash_upsert(&histogram, sales[i].quantity, 0))++;
+    }
+    for (int q = 1; q <= 5; q++) {
+        printf("quantity %d: %ld sales\n", q, *hash_find(&histogram, q));
+    }
+
+    // Join the sales with the stores in two cities
+    store_t cities[] = { { 2, "Lille" }, { 5, "Lyon" }, { 9, "Paris" } };
+    long lille = 0, lyon = 0;
+    size_t pairs = hash_join(int, sale_t, store_t, sales, n, cities, 3,
+        { return value.store; }, { return value.id; },
+        { if (right.id == 2) lille += left.quantity; else lyon += left.quantity; });
+    printf("%zu sales joined: %ld items in Lille, %ld in Lyon\n", pairs, lille, lyon);
+
+    hash_free(&revenue);
+    hash_free(&items);
+    hash_free(&histogram);
+    free(sales);
+    return 0;
+}
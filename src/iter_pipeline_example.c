@@ -0,0 +1,73 @@
+/**
+ * @file iter_pipeline_example.c
+ * @brief Example of lazy iterator pipelines in LambdaCraft.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include "lambda_iter.h"
+
+/**
+ * @brief Node structure for a simple singly linked list.
+ */
+typedef struct Node {
+    int data;
+    struct Node* next;
+} Node;
+
+int main(int argc, char **argv) {
+    int numbers[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    int mapped = 0;
+
+    // Halve the numbers, keep those above 1, sum the first three:
+    // one loop, stopped after the fifth number
+    double total = iter_fold(double, double,
+        iter_take(double,
+            iter_filter(double,
+                iter_map(int, double,
+                    iter_array(int, numbers, 10),
+                    { mapped++; return value * 0.5; }),
+                { return value > 1.0; }),
+            3),
+        { return acc + value; }, 0.0);
+    printf("Total: %f (%d numbers mapped)\n", total, mapped);
+
+    // First ten powers of two from an endless generator
+    long powers[10];
+    lc_index_t count = iter_collect(long,
+        iter_gen(long, 1, { return 2 * value; }),
+        powers, 10);
+    for (lc_index_t i = 0; i < count; i++) {
+        printf("%ld ", powers[i]);
+    }
+    printf("\n");
+
+    // First node of a list whose square exceeds 10
+    Node n3 = {5, NULL}, n2 = {3, &n3}, n1 = {1, &n2};
+    Node *found = iter_find(Node*,
+        iter_s(Node*, &n1, { return value->next; }),
+        { return value->data * value->data > 10; }, NULL);
+    printf("Found: %d\n", found ? found->data : -1);
+
+    return 0;
+}
@@ -24,7 +24,9 @@
  */
 
 #include <stdio.h>
-#include "lambda.h"
+#include "lambda_parallel.h"
+#include "lambda_simd.h"
+#include "lambda_sort.h"
 
 int main(int argc, char **argv) {
     // Nested value for the map operation
@@ -47,6 +49,73 @@ int main(int argc, char **argv) {
         printf("Source: %f -> Mapped: %f\n", sourceNumbers[i], mappedNumbers[i]);
     }
 
+    // Same map spread over 4 threads, with both schedules
+    double staticNumbers[9], dynamicNumbers[9];
+    pmap(double, sourceNumbers, 9,
+        {return value + nestedValue;},
+        staticNumbers, 4, LC_STATIC
+    );
+    pmap(double, sourceNumbers, 9,
+        {return value + nestedValue;},
+        dynamicNumbers, 4, LC_DYNAMIC
+    );
+    for(int i = 0; i < 9; i++) {
+        printf("Static: %f, Dynamic: %f\n", staticNumbers[i], dynamicNumbers[i]);
+    }
+
+    // Sum of the mapped values without storing them, then over 4 threads
+    double total = map_fold(double, double, double, sourceNumbers, 9,
+        {return value + nestedValue;},
+        {return acc + value;}, 0.0
+    );
+    double ptotal = pmap_fold(double, double, double, sourceNumbers, 9,
+        {return value + nestedValue;},
+        {return acc + value;},
+        {return acc + value;}, 0.0, 4
+    );
+    printf("Sum of mapped values: %f (%f in parallel)\n", total, ptotal);
+
+    // Combine the source and mapped values element-wise, then their dot product
+    double combined[9];
+    zip_map(double, (double, double, double), (sourceNumbers, mappedNumbers, staticNumbers), 9,
+        {return a * nestedValue + b - c;},
+        combined
+    );
+    double dot = zip_fold(double, (double, double), (sourceNumbers, mappedNumbers), 9,
+        {return acc + a * b;}, 0.0
+    );
+    printf("Combined: %f ... %f, dot product: %f\n", combined[0], combined[8], dot);
+
+    // Keep the values above 5, with a lambda then with a vector predicate
+    double kept[9], keptSimd[9];
+    lc_index_t count = filter(double, sourceNumbers, 9,
+        {return value > 5.0;}, kept);
+    lc_index_t countSimd = filter_simd(double, sourceNumbers, 9,
+        {value > 5.0;}, keptSimd);
+    for(lc_index_t i = 0; i < count; i++) {
+        printf("Kept: %f\n", kept[i]);
+    }
+    printf("%zu kept, %zu with filter_simd\n", (size_t)count, (size_t)countSimd);
+
+    // Halve the kept values in place, then round them to integers
+    map_inplace(double, kept, count, {return value / 2;});
+    long rounded[9];
+    map_to(double, long, kept, count, {return (long)(value + 0.5);}, rounded);
+    for(lc_index_t i = 0; i < count; i++) {
+        printf("Halved: %f -> Rounded: %ld\n", kept[i], rounded[i]);
+    }
+
+    // Sort the mapped values in decreasing order, and the rounded ones by
+    // their last digit
+    sort(double, mappedNumbers, 9, {return a > b;});
+    sort_by_key(long, int, rounded, count, {return value % 10;});
+    for(int i = 0; i < 9; i++) {
+        printf("Sorted: %f\n", mappedNumbers[i]);
+    }
+    for(lc_index_t i = 0; i < count; i++) {
+        printf("By last digit: %ld\n", rounded[i]);
+    }
+
     return 0;
 }
 
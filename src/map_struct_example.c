@@ -25,7 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "lambda.h"
+#include "lambda_arena.h"
 
 /**
  * @brief Node structure for a simple singly linked list.
@@ -52,15 +52,17 @@ int main(int argc, char **argv) {
     }
     printf("NULL\n");
 
-    // Map using the `map_s` macro to square the data of each node.
-    Node* new_head = map_s(Node*, head, 
+    // Map using the `map_s_arena` macro to square the data of each node,
+    // the new nodes being allocated from an arena.
+    lc_arena nodes = LC_ARENA_INIT;
+    Node* new_head = map_s_arena(Node*, head, 
         { return value->next; }, 
         { 
-            Node *r_value = malloc(sizeof(Node));
+            Node *r_value = lc_arena_new(arena, Node);
             r_value->data = value->data * value->data;
             r_value->next = next; 
             return r_value; 
-        }
+        }, &nodes
     );
 
     // Print the mapped list.
@@ -77,12 +79,8 @@ int main(int argc, char **argv) {
         free(temp);
     }
 
-    // Cleanup the new mapped linked list.
-    while(new_head) {
-        Node* temp = new_head;
-        new_head = new_head->next;
-        free(temp);
-    }
+    // Cleanup the new mapped linked list at once.
+    lc_arena_release(&nodes);
 
     return 0;
 }
@@ -0,0 +1,73 @@
+/**
+ * @file map_struct_long_example.c
+ * @brief Example of using map_s on a very long linked list in LambdaCraft.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "lambda.h"
+
+/**
+ * @brief Node structure for a simple singly linked list.
+ */
+typedef struct Node {
+    long data;
+    struct Node* next;
+} Node;
+
+int main(int argc, char **argv) {
+    // Number of nodes, far more than a recursive traversal could stack
+    long size = argc > 1 ? atol(argv[1]) : 1000000;
+
+    // Build the list 0 -> 1 -> ... -> size-1
+    Node *head = NULL;
+    for (long i = size - 1; i >= 0; i--) {
+        Node *n = malloc(sizeof(Node));
+        n->data = i;
+        n->next = head;
+        head = n;
+    }
+
+    // Map each node to a new node holding twice its value
+    Node *doubled = map_s(Node*, head,
+        { return value->next; },
+        {
+            Node *r_value = malloc(sizeof(Node));
+            r_value->data = 2 * value->data;
+            r_value->next = next;
+            return r_value;
+        }
+    );
+
+    // Check the mapped list, in order
+    long sum = fold_s(long, Node*, doubled,
+        { return value->next; },
+        { return acc + value->data; }, 0);
+    printf("%ld nodes mapped, sum %ld (expected %ld)\n", size, sum, size * (size - 1));
+
+    // Cleanup both lists, the second one prefetching 8 nodes ahead
+    foreach_s(Node*, head, { Node *r = value->next; free(value); return r; });
+    foreach_s_prefetch(Node*, doubled, { return value->next; }, { free(value); }, 8);
+
+    return 0;
+}
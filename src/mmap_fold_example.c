@@ -0,0 +1,71 @@
+/**
+ * @file mmap_fold_example.c
+ * @brief Example of folding a memory-mapped file with 64-bit indices in LambdaCraft.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "lambda.h"
+
+int main(int argc, char **argv) {
+    // Number of one-byte elements; make large passes 5000000000, past 2^32
+    size_t size = argc > 1 ? strtoull(argv[1], NULL, 10) : 1 << 24;
+    if (size < 3) size = 3;
+
+    // Sparse temporary file of zeros, with a mark at its start, middle and end
+    FILE *file = tmpfile();
+    if (!file || ftruncate(fileno(file), size) != 0) {
+        perror("tmpfile");
+        return 1;
+    }
+    size_t marks[3] = {0, size / 2, size - 1};
+    for (int m = 0; m < 3; m++) {
+        if (pwrite(fileno(file), "\1", 1, marks[m]) != 1) {
+            perror("pwrite");
+            return 1;
+        }
+    }
+
+    unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    // Count the marks and find the position of the last one
+    size_t count = fold(size_t, unsigned char, data, size,
+        { return acc + value; }, 0);
+    size_t last = fold(size_t, unsigned char, data, size,
+        { return value ? index : acc; }, 0);
+    printf("%zu elements: %zu marks, last one at %zu\n", size, count, last);
+    if (count != 3 || last != size - 1) {
+        fprintf(stderr, "expected 3 marks, last one at %zu\n", size - 1);
+        return 1;
+    }
+
+    munmap(data, size);
+    fclose(file);
+    return 0;
+}
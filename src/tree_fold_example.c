@@ -0,0 +1,79 @@
+/**
+ * @file tree_fold_example.c
+ * @brief Example of a parallel fold over a binary tree with spawn and join.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "lambda_task.h"
+
+// Define a binary tree structure
+typedef struct tree_s {
+  long value;
+  struct tree_s *left, *right;
+} tree_t;
+
+// Build a balanced tree holding the values lo ... hi-1
+tree_t *build(long lo, long hi) {
+    if (lo >= hi) return NULL;
+    long mid = lo + (hi - lo) / 2;
+    tree_t *node = malloc(sizeof(tree_t));
+    node->value = mid;
+    node->left = build(lo, mid);
+    node->right = build(mid + 1, hi);
+    return node;
+}
+
+// Fold the tree, the left subtree being a task that another thread may steal
+long tree_fold(tree_t *node, long depth) {
+    if (node == NULL) return 0;
+    long left, right;
+    if (depth > 0) {
+        spawn({ left = tree_fold(node->left, depth - 1); });
+    } else {
+        left = tree_fold(node->left, 0);
+    }
+    right = tree_fold(node->right, depth - 1);
+    join();
+    return node->value * node->value + left + right;
+}
+
+int main(int argc, char **argv) {
+    long n = 100000;
+    tree_t *root = build(0, n);
+
+    // Sum of squares, spawning tasks over the 10 upper levels of the tree
+    printf("Sum of squares of 0..%ld: %ld\n", n - 1, tree_fold(root, 10));
+
+    // Free the tree with tasks too, children before their parent
+    void release(tree_t *node) {
+        if (node == NULL) return;
+        spawn({ release(node->left); });
+        release(node->right);
+        join();
+        free(node);
+    }
+    release(root);
+
+    return 0;
+}
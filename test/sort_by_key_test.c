@@ -0,0 +1,84 @@
+/**
+ * @file sort_by_key_test.c
+ * @brief Check sort_by_key on negative and mixed signed keys, on the
+ * radix path and on the fallback taken when no buffer can be allocated.
+ *
+ * Copyright (C) 2023 Gilles Grimaud
+ *
+ * This file is part of LambdaCraft.
+ *
+ * LambdaCraft is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LambdaCraft is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with LambdaCraft. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Contributors:
+ * - Gilles Grimaud <gilles.grimaud.code@gmail.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Set to make every sort buffer allocation fail. */
+static int fail_alloc;
+#define LAMBDA_SORT_ALLOC(bytes) (fail_alloc ? NULL : malloc(bytes))
+
+#include "lambda_sort.h"
+
+#define N 1000
+
+static int failures;
+
+static void check(const char *what, const long *a, lc_index_t n) {
+    for (lc_index_t i = 1; i < n; i++)
+        if (a[i - 1] > a[i]) {
+            printf("FAIL %s: a[%ld] = %ld > a[%ld] = %ld\n",
+                   what, (long)i - 1, a[i - 1], (long)i, a[i]);
+            failures++;
+            return;
+        }
+    printf("ok   %s\n", what);
+}
+
+static void fill(long *a, lc_index_t n, long bias) {
+    srand(1);
+    for (lc_index_t i = 0; i < n; i++)
+        a[i] = rand() % 2001 - bias;
+}
+
+int main(void) {
+    static long a[N];
+    for (fail_alloc = 0; fail_alloc < 2; fail_alloc++) {
+        const char *path = fail_alloc ? "fallback" : "radix";
+        char what[64];
+
+        fill(a, N, 1000);
+        sort_by_key(long, int, a, N, { return (int)value; });
+        snprintf(what, sizeof(what), "%s, mixed int keys", path);
+        check(what, a, N);
+
+        fill(a, N, 3000);
+        sort_by_key(long, int, a, N, { return (int)value; });
+        snprintf(what, sizeof(what), "%s, negative int keys", path);
+        check(what, a, N);
+
+        fill(a, N, 1000);
+        sort_by_key(long, short, a, N, { return (short)value; });
+        snprintf(what, sizeof(what), "%s, mixed short keys", path);
+        check(what, a, N);
+
+        fill(a, N, 1000);
+        sort_by_key(long, long, a, N, { return value; });
+        snprintf(what, sizeof(what), "%s, mixed long keys", path);
+        check(what, a, N);
+    }
+    return failures != 0;
+}